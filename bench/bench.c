@@ -0,0 +1,1723 @@
+// Microbenchmarks for the modules which do not depend on macOS frameworks.
+// Built and run on Linux via `make bench`, allocations are counted by
+// wrapping the allocator at link time (-Wl,--wrap=...).
+#include "hashtable.h"
+#include "parse.h"
+#include "misc/color.h"
+#include "blend.h"
+#include "oklab.h"
+#include "timeline.h"
+#include "gradient.h"
+#include "angle.h"
+#include "easing.h"
+#include "animation.h"
+#include "histogram.h"
+#include "gradient_cache.h"
+#include "space_index.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+static uint64_t g_allocations;
+
+void* __wrap_malloc(size_t size) {
+  g_allocations++;
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  g_allocations++;
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  g_allocations++;
+  return __real_realloc(ptr, size);
+}
+
+struct bench {
+  const char* name;
+  uint64_t start_ns;
+  uint64_t start_allocations;
+};
+
+static uint64_t bench_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void bench_begin(struct bench* bench, const char* name) {
+  bench->name = name;
+  bench->start_allocations = g_allocations;
+  bench->start_ns = bench_now_ns();
+}
+
+static void bench_end(struct bench* bench, uint64_t ops) {
+  uint64_t ns = bench_now_ns() - bench->start_ns;
+  uint64_t allocations = g_allocations - bench->start_allocations;
+  printf("%-44s %10.2f ns/op %8.3f allocs/op\n",
+         bench->name,
+         (double)ns / ops,
+         (double)allocations / ops                 );
+}
+
+// Element count of an array, as an int for loop counters
+#define BENCH_COUNT(array) (int)(sizeof(array) / sizeof((array)[0]))
+
+// Volatile sink to keep results of the measured calls alive
+static volatile uintptr_t g_sink;
+
+// The identity hash which used to key g_windows
+static TABLE_HASH_FUNC(hash_window_identity) {
+  return *(uint32_t*)key;
+}
+
+static TABLE_COMPARE_FUNC(cmp_window) {
+  return *(uint32_t*)key_a == *(uint32_t*)key_b;
+}
+
+static uint32_t bench_wid(int i) {
+  // Window ids are mostly sequential with a few gaps
+  return 100 + i + (i / 7) * 3;
+}
+
+static void bench_windows(int count, int rounds) {
+  char name[64];
+  struct bench bench;
+  uint64_t ops = (uint64_t)count * rounds;
+
+  snprintf(name, sizeof(name), "chained/insert+remove n=%d", count);
+  bench_begin(&bench, name);
+  for (int r = 0; r < rounds; r++) {
+    struct table table;
+    table_init(&table, 1024, hash_window_identity, cmp_window);
+    for (int i = 0; i < count; i++) {
+      uint32_t wid = bench_wid(i);
+      table_add(&table, &wid, (void*)(uintptr_t)wid);
+    }
+    for (int i = 0; i < count; i++) {
+      uint32_t wid = bench_wid(i);
+      table_remove(&table, &wid);
+    }
+    table_free(&table);
+  }
+  bench_end(&bench, ops);
+
+  snprintf(name, sizeof(name), "wid_table/insert+remove n=%d", count);
+  bench_begin(&bench, name);
+  for (int r = 0; r < rounds; r++) {
+    struct wid_table table;
+    wid_table_init(&table, 1024);
+    for (int i = 0; i < count; i++) {
+      wid_table_add(&table, bench_wid(i), (void*)(uintptr_t)bench_wid(i));
+    }
+    for (int i = 0; i < count; i++) {
+      wid_table_remove(&table, bench_wid(i));
+    }
+    wid_table_free(&table);
+  }
+  bench_end(&bench, ops);
+
+  struct table chained;
+  struct wid_table open;
+  table_init(&chained, 1024, hash_window_identity, cmp_window);
+  wid_table_init(&open, 1024);
+  for (int i = 0; i < count; i++) {
+    uint32_t wid = bench_wid(i);
+    table_add(&chained, &wid, (void*)(uintptr_t)wid);
+    wid_table_add(&open, wid, (void*)(uintptr_t)wid);
+  }
+
+  // Lookups hit three out of four times
+  snprintf(name, sizeof(name), "chained/find n=%d", count);
+  bench_begin(&bench, name);
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < count; i++) {
+      uint32_t wid = bench_wid(i) + ((i & 3) == 3 ? 1000000 : 0);
+      g_sink += (uintptr_t)table_find(&chained, &wid);
+    }
+  }
+  bench_end(&bench, ops);
+
+  snprintf(name, sizeof(name), "wid_table/find n=%d", count);
+  bench_begin(&bench, name);
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < count; i++) {
+      uint32_t wid = bench_wid(i) + ((i & 3) == 3 ? 1000000 : 0);
+      g_sink += (uintptr_t)wid_table_find(&open, wid);
+    }
+  }
+  bench_end(&bench, ops);
+
+  // Window churn: one window closes and another one opens
+  snprintf(name, sizeof(name), "chained/churn n=%d", count);
+  bench_begin(&bench, name);
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < count; i++) {
+      uint32_t wid = bench_wid(i) + r * count * 2;
+      uint32_t next = bench_wid(i) + (r + 1) * count * 2;
+      table_remove(&chained, &wid);
+      table_add(&chained, &next, (void*)(uintptr_t)next);
+    }
+  }
+  bench_end(&bench, ops);
+
+  snprintf(name, sizeof(name), "wid_table/churn n=%d", count);
+  bench_begin(&bench, name);
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < count; i++) {
+      uint32_t wid = bench_wid(i) + r * count * 2;
+      uint32_t next = bench_wid(i) + (r + 1) * count * 2;
+      wid_table_remove(&open, wid);
+      wid_table_add(&open, next, (void*)(uintptr_t)next);
+    }
+  }
+  bench_end(&bench, ops);
+
+  table_free(&chained);
+  wid_table_free(&open);
+}
+
+// Old slots a wid_table_add scanned for migration, the slot of the added key
+// aside. A growth which had to finish the previous migration first shows up
+// as the whole rest of that migration.
+static int bench_migrated_slots(struct wid_array* old_before, int index_before, struct wid_table* table) {
+  if (!old_before) return 0;
+  if (atomic_load(&table->old) == old_before) {
+    return table->migrate_index - index_before;
+  }
+  return old_before->capacity - index_before;
+}
+
+// Latency of every single insert while the tables grow from 1k to 100k
+// windows: the chained table rehashes everything at once when it grows,
+// while the wid_table spreads its migration over the following inserts. The
+// wall clock is too noisy to assert on, the bound on the migration work of
+// an insert is checked instead.
+static void bench_insert_latency(int count, int rounds) {
+  static struct histogram chained_latency;
+  static struct histogram open_latency;
+  histogram_reset(&chained_latency);
+  histogram_reset(&open_latency);
+  uint64_t errors = 0;
+  int max_migrated = 0;
+
+  for (int r = 0; r < rounds; r++) {
+    struct table chained;
+    table_init(&chained, 1024, hash_window_identity, cmp_window);
+    for (int i = 0; i < count; i++) {
+      uint32_t wid = bench_wid(i);
+      uint64_t start = bench_now_ns();
+      table_add(&chained, &wid, (void*)(uintptr_t)wid);
+      histogram_record(&chained_latency, bench_now_ns() - start);
+    }
+    table_free(&chained);
+
+    struct wid_table open;
+    wid_table_init(&open, 1024);
+    for (int i = 0; i < count; i++) {
+      uint32_t wid = bench_wid(i);
+      struct wid_array* old = atomic_load(&open.old);
+      int index = open.migrate_index;
+      uint64_t start = bench_now_ns();
+      wid_table_add(&open, wid, (void*)(uintptr_t)wid);
+      histogram_record(&open_latency, bench_now_ns() - start);
+
+      int migrated = bench_migrated_slots(old, index, &open);
+      if (migrated > max_migrated) max_migrated = migrated;
+      errors += migrated > WID_TABLE_MIGRATE_STEP;
+    }
+    errors += open.count != count;
+    wid_table_free(&open);
+  }
+
+  char name[64];
+  snprintf(name, sizeof(name), "chained/insert latency n=1k..%dk", count / 1000);
+  printf("%-44s %10.2f us p99 %10.2f us max\n",
+         name,
+         histogram_percentile(&chained_latency, 0.99) / 1e3,
+         atomic_load(&chained_latency.max) / 1e3            );
+  snprintf(name, sizeof(name), "wid_table/insert latency n=1k..%dk", count / 1000);
+  printf("%-44s %10.2f us p99 %10.2f us max\n",
+         name,
+         histogram_percentile(&open_latency, 0.99) / 1e3,
+         atomic_load(&open_latency.max) / 1e3            );
+  printf("%-44s %10d slots max, %" PRIu64 " errors\n",
+         "wid_table/migration per insert", max_migrated, errors);
+}
+
+// Readers looking windows up while the writer adds and removes them and the
+// table migrates. Removed records are retired through the table and their
+// release only poisons them, so a reader handed a released or foreign record
+// counts an error instead of crashing. The first keys are never removed and
+// must always be found.
+struct bench_record {
+  uint32_t key;
+  atomic_bool released;
+  struct bench_record* next;
+};
+
+// Released records, only touched by the writer which runs the releases
+static struct bench_record* g_bench_released;
+
+static EPOCH_FREE_FUNC(bench_record_release) {
+  struct bench_record* record = ptr;
+  atomic_store(&record->released, true);
+  record->next = g_bench_released;
+  g_bench_released = record;
+}
+
+static struct bench_record* bench_record_create(uint32_t key) {
+  struct bench_record* record = malloc(sizeof(struct bench_record));
+  record->key = key;
+  atomic_init(&record->released, false);
+  record->next = NULL;
+  return record;
+}
+
+struct bench_reader {
+  pthread_t thread;
+  struct wid_table* table;
+  atomic_bool* done;
+  uint32_t seed;
+  uint32_t stable;
+  uint32_t keys;
+  uint64_t lookups;
+  uint64_t migrating;
+  uint64_t errors;
+};
+
+static void* bench_reader_proc(void* context) {
+  struct bench_reader* reader = context;
+  uint32_t state = reader->seed;
+  while (!atomic_load(reader->done)) {
+    state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+    uint32_t key = 1 + state % reader->keys;
+
+    uint64_t entered = wid_table_read_begin(reader->table);
+    reader->migrating += atomic_load(&reader->table->old) != NULL;
+    struct bench_record* record = wid_table_find(reader->table, key);
+
+    // Being preempted while holding the record is what the read section
+    // protects against
+    if (++reader->lookups % 256 == 0) sched_yield();
+    if (record) {
+      reader->errors += record->key != key
+                        || atomic_load(&record->released);
+    }
+    else reader->errors += key <= reader->stable;
+    wid_table_read_end(reader->table, entered);
+  }
+  return NULL;
+}
+
+static void bench_wid_table_readers(int readers, uint32_t grow, int churn) {
+  const uint32_t stable = 256;
+  struct wid_table table;
+  atomic_bool done;
+  atomic_init(&done, false);
+
+  // Starting small, the growth runs through a dozen migrations
+  wid_table_init(&table, 16);
+  for (uint32_t key = 1; key <= stable; key++) {
+    wid_table_add(&table, key, bench_record_create(key));
+  }
+
+  struct bench_reader workers[readers];
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < readers; i++) {
+    workers[i] = (struct bench_reader){ .table = &table,
+                                        .done = &done,
+                                        .seed = 0x9e3779b9 * (i + 1),
+                                        .stable = stable,
+                                        .keys = stable + grow };
+    pthread_create(&workers[i].thread, NULL, bench_reader_proc, &workers[i]);
+  }
+
+  uint64_t writes = 0;
+  for (uint32_t key = stable + 1; key <= stable + grow; key++) {
+    wid_table_add(&table, key, bench_record_create(key));
+    if (++writes % 64 == 0) sched_yield();
+  }
+
+  // Windows closing and reopening under the same id with a new record, a
+  // reader handed the old one after its release counts an error
+  uint32_t state = 0x510e527f;
+  for (int i = 0; i < churn; i++) {
+    state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+    uint32_t key = stable + 1 + state % grow;
+    struct bench_record* record = wid_table_find(&table, key);
+    wid_table_remove(&table, key);
+    wid_table_retire_value(&table, record, bench_record_release);
+    wid_table_add(&table, key, bench_record_create(key));
+    if (++writes % 64 == 0) sched_yield();
+  }
+
+  atomic_store(&done, true);
+  uint64_t lookups = 0, migrating = 0, errors = 0;
+  for (int i = 0; i < readers; i++) {
+    pthread_join(workers[i].thread, NULL);
+    lookups += workers[i].lookups;
+    migrating += workers[i].migrating;
+    errors += workers[i].errors;
+  }
+  uint64_t ns = bench_now_ns() - start;
+
+  // Every record removed during the run has to have been released by now or
+  // once the table is torn down, and none of them twice
+  int cursor = 0;
+  struct bench_record* record;
+  uint64_t remaining = 0;
+  while ((record = wid_table_iterate(&table, &cursor, NULL))) {
+    bench_record_release(record);
+    remaining++;
+  }
+  wid_table_free(&table);
+  uint64_t released = 0;
+  while (g_bench_released) {
+    record = g_bench_released;
+    g_bench_released = record->next;
+    free(record);
+    released++;
+  }
+  errors += remaining != stable + grow || released != remaining + churn;
+
+  char name[64];
+  snprintf(name, sizeof(name), "wid_table/find readers=%d", readers);
+  printf("%-44s %10.2f ns/op %6.1f%% migrating, %" PRIu64 " errors\n",
+         name, (double)ns / lookups, 100.0 * migrating / lookups, errors);
+  printf("%-44s %10.2f M lookups/s over %" PRIu64 " writes\n",
+         name, lookups * 1e3 / ns, writes);
+}
+
+static void bench_blacklist(bool pooled, int cycles) {
+  static const char* apps[] = { "Safari", "kitty", "Finder", "Mail",
+                                "System Settings", "Activity Monitor",
+                                "com.apple.Spotlight.extension.Helper",
+                                "Visual Studio Code" };
+  int app_count = sizeof(apps) / sizeof(apps[0]);
+
+  struct table table;
+  if (pooled) table_init_pooled(&table, 64, table_hash_string, table_cmp_string);
+  else table_init(&table, 64, table_hash_string, table_cmp_string);
+
+  struct bench bench;
+  bench_begin(&bench, pooled ? "blacklist/pooled insert+remove"
+                             : "blacklist/malloc insert+remove");
+  for (int i = 0; i < cycles; i++) {
+    const char* app = apps[i % app_count];
+    _table_add(&table, (void*)app, strlen(app) + 1, (void*)true);
+    table_remove(&table, (void*)app);
+  }
+  bench_end(&bench, cycles);
+
+  bench_begin(&bench, pooled ? "blacklist/pooled find"
+                             : "blacklist/malloc find");
+  for (int i = 0; i < app_count; i++) {
+    _table_add(&table, (void*)apps[i], strlen(apps[i]) + 1, (void*)true);
+  }
+  for (int i = 0; i < cycles; i++) {
+    g_sink += (uintptr_t)table_find(&table, (void*)apps[i % app_count]);
+  }
+  bench_end(&bench, cycles);
+
+  bench_begin(&bench, pooled ? "blacklist/pooled refill+clear"
+                             : "blacklist/malloc refill+clear");
+  for (int i = 0; i < cycles / app_count; i++) {
+    table_clear(&table);
+    for (int j = 0; j < app_count; j++) {
+      _table_add(&table, (void*)apps[j], strlen(apps[j]) + 1, (void*)true);
+    }
+  }
+  bench_end(&bench, cycles / app_count);
+  table_free(&table);
+}
+
+// Replays synthetic window events against the space index: windows are
+// created and destroyed, move between spaces, toggle their sticky tag and the
+// whole registry is occasionally recreated. After every event the lists are
+// checked against a brute force scan of all windows.
+#define BENCH_SPACES 16
+
+struct bench_window {
+  bool alive;
+  bool sticky;
+  uint64_t sid;
+  struct space_link link;
+};
+
+static SPACE_VISIBLE_FUNC(bench_space_visible) {
+  return sid % 3 == 0;
+}
+
+static uint64_t bench_space_check(struct space_index* index, struct bench_window* windows, int count) {
+  uint64_t errors = 0;
+  int alive = 0;
+  bool used[BENCH_SPACES + 1] = { 0 };
+  for (int i = 0; i < count; i++) {
+    struct bench_window* window = &windows[i];
+    if (!window->alive) {
+      errors += window->link.list != NULL;
+      continue;
+    }
+    alive++;
+    uint64_t sid = window->sticky ? 0 : window->sid;
+    used[sid] = true;
+    errors += !window->link.list
+              || window->link.list->sid != sid
+              || space_index_find(index, sid) != window->link.list;
+  }
+
+  int lists = 0, filed = 0, cursor = 0;
+  struct bucket* bucket = NULL;
+  struct space_list* list;
+  while ((list = space_index_iterate(index, &cursor, &bucket))) {
+    lists++;
+    errors += !list->head || list->sid > BENCH_SPACES;
+    errors += list->visible != (list->sid == 0 || bench_space_visible(list->sid));
+    struct space_link* prev = NULL;
+    for (struct space_link* link = list->head; link; link = link->next) {
+      struct bench_window* window = link->owner;
+      errors += link->prev != prev || link->list != list;
+      errors += !window->alive
+                || (window->sticky ? 0 : window->sid) != list->sid;
+      prev = link;
+      filed++;
+    }
+  }
+
+  int spaces = 0;
+  for (int i = 0; i <= BENCH_SPACES; i++) spaces += used[i];
+  errors += filed != alive || lists != spaces;
+  return errors;
+}
+
+static void bench_space_index(int count, int events) {
+  struct bench_window* windows = calloc(count, sizeof(struct bench_window));
+  for (int i = 0; i < count; i++) windows[i].link.owner = &windows[i];
+
+  struct space_index index;
+  space_index_init(&index, 64, bench_space_visible);
+
+  uint64_t errors = 0;
+  uint64_t moves = 0;
+  uint32_t state = 0x3c6ef372;
+  for (int i = 0; i < events; i++) {
+    state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+    struct bench_window* window = &windows[state % count];
+    uint32_t event = (state >> 16) % 100;
+
+    if (event == 0) {
+      // Recreating all borders drops the index along with every window
+      space_index_clear(&index);
+      for (int j = 0; j < count; j++) {
+        windows[j].alive = false;
+        windows[j].link.list = NULL;
+        windows[j].link.next = windows[j].link.prev = NULL;
+      }
+    } else if (!window->alive) {
+      window->alive = true;
+      window->sid = 1 + (state >> 8) % BENCH_SPACES;
+      window->sticky = (state >> 4) % 10 == 0;
+      space_index_file(&index, &window->link,
+                       window->sticky ? 0 : window->sid);
+    } else if (event < 30) {
+      window->alive = false;
+      space_index_unlink(&index, &window->link);
+    } else if (event < 70) {
+      window->sid = 1 + (state >> 8) % BENCH_SPACES;
+      moves += space_index_file(&index, &window->link,
+                                window->sticky ? 0 : window->sid);
+    } else {
+      window->sticky = !window->sticky;
+      moves += space_index_file(&index, &window->link,
+                                window->sticky ? 0 : window->sid);
+    }
+    errors += bench_space_check(&index, windows, count);
+  }
+
+  char name[64];
+  snprintf(name, sizeof(name), "space_index/replay windows=%d", count);
+  printf("%-44s %10d events, %" PRIu64 " moves, %" PRIu64 " errors\n",
+         name, events, moves, errors);
+  space_index_free(&index);
+  free(windows);
+}
+
+static void bench_parse(int rounds) {
+  static const char* arguments[] = {
+    "style=round",
+    "width=6.0",
+    "hidpi=off",
+    "active_color=0xffe2e2e3",
+    "inactive_color=0xff414550",
+    "background_color=0x11414550",
+    "order=above",
+    "blacklist=Safari,kitty,Finder,System Settings",
+    "animated_gradient=on",
+    "animated_gradient_colors=ff5f87,ffaf5f,d7ff5f,5fffaf,5fafff,af5fff",
+    "animated_gradient_steps=60",
+    "animated_gradient_duration=12.5",
+  };
+  int count = sizeof(arguments) / sizeof(arguments[0]);
+
+  struct settings settings;
+  memset(&settings, 0, sizeof(struct settings));
+  table_init_pooled(&settings.blacklist, 64, table_hash_string, table_cmp_string);
+  table_init_pooled(&settings.whitelist, 64, table_hash_string, table_cmp_string);
+
+  char* argv[count];
+  struct bench bench;
+  bench_begin(&bench, "parse_settings/config (12 args)");
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < count; i++) argv[i] = (char*)arguments[i];
+    g_sink += parse_settings(&settings, count, argv);
+  }
+  bench_end(&bench, rounds);
+
+  bench_begin(&bench, "parse_settings/single colour");
+  for (int r = 0; r < rounds; r++) {
+    argv[0] = (char*)arguments[3];
+    g_sink += parse_settings(&settings, 1, argv);
+  }
+  bench_end(&bench, rounds);
+
+  gradient_palette_release(settings.animated_gradient_palette);
+  table_free(&settings.blacklist);
+  table_free(&settings.whitelist);
+}
+
+static void bench_interpolate(int rounds) {
+  static const uint32_t palette[] = { 0xffff5f87, 0xffffaf5f, 0xffd7ff5f,
+                                      0xff5fffaf, 0xff5fafff, 0x00af5fff };
+  int palette_count = sizeof(palette) / sizeof(palette[0]);
+  int steps = 50;
+
+  struct bench bench;
+  bench_begin(&bench, "interpolate_color_value");
+  uint32_t acc = 0;
+  for (int r = 0; r < rounds; r++) {
+    uint32_t from = palette[r % palette_count];
+    uint32_t to = palette[(r + 1) % palette_count];
+    for (int step = 0; step <= steps; step++) {
+      acc ^= interpolate_color_value(from, to, step, steps);
+    }
+  }
+  g_sink += acc;
+  bench_end(&bench, (uint64_t)rounds * (steps + 1));
+}
+
+static void bench_blend(int count, int rounds) {
+  uint32_t* from = malloc(sizeof(uint32_t) * count);
+  uint32_t* to = malloc(sizeof(uint32_t) * count);
+  uint32_t* expected = malloc(sizeof(uint32_t) * count);
+  uint32_t* out = malloc(sizeof(uint32_t) * count);
+  uint32_t state = 0x9e3779b9;
+  for (int i = 0; i < count; i++) {
+    state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+    from[i] = state;
+    state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+    to[i] = state;
+  }
+  if (count > 0) from[0] &= 0x00ffffff; // transparent source
+  int steps = 60;
+
+  // Throughput per million colours at every step of a transition
+  char name[64];
+  struct bench bench;
+  uint64_t ops = (uint64_t)count * rounds * (steps + 1);
+  snprintf(name, sizeof(name), "interpolate_color_value/1M colours");
+  bench_begin(&bench, name);
+  for (int r = 0; r < rounds; r++) {
+    for (int step = 0; step <= steps; step++) {
+      for (int i = 0; i < count; i++) {
+        out[i] = interpolate_color_value(from[i], to[i], step, steps);
+      }
+      g_sink += out[step % count];
+    }
+  }
+  bench_end(&bench, ops / 1000000);
+
+  snprintf(name, sizeof(name), "blend_colors/1M colours");
+  bench_begin(&bench, name);
+  for (int r = 0; r < rounds; r++) {
+    for (int step = 0; step <= steps; step++) {
+      blend_colors(from, to, out, count, step, steps);
+      g_sink += out[step % count];
+    }
+  }
+  bench_end(&bench, ops / 1000000);
+
+  // The kernel has to reproduce the double rounding exactly
+  uint64_t mismatches = 0;
+  int max_steps[] = { 0, 1, 7, 60, 2048, 2049, 100000 };
+  for (int m = 0; m < BENCH_COUNT(max_steps); m++) {
+    for (int step = -1; step <= max_steps[m] + 1; step += max_steps[m] / 61 + 1) {
+      blend_colors(from, to, out, count, step, max_steps[m]);
+      for (int i = 0; i < count; i++) {
+        expected[i] = interpolate_color_value(from[i], to[i], step, max_steps[m]);
+        mismatches += out[i] != expected[i];
+      }
+    }
+  }
+
+  int table_steps = 300;
+  uint32_t* table = malloc(sizeof(uint32_t) * (table_steps + 1));
+  for (int i = 0; i + 1 < count && i < 256; i++) {
+    blend_color_steps(from[i], to[i], table, table_steps);
+    for (int step = 0; step <= table_steps; step++) {
+      uint32_t value = interpolate_color_value(from[i], to[i], step, table_steps);
+      mismatches += table[step] != value;
+    }
+  }
+  free(table);
+  printf("%-44s %10" PRIu64 " mismatches\n", "blend_colors/exactness", mismatches);
+
+  free(from);
+  free(to);
+  free(expected);
+  free(out);
+}
+
+// Transition tables are built once per colour pair, the frames then only
+// index into them: compare the build and the per-frame cost of both spaces
+static void bench_color_space(int rounds) {
+  static const uint32_t palette[] = { 0xffff5f87, 0xffffaf5f, 0xffd7ff5f,
+                                      0xff5fffaf, 0xff5fafff, 0x00af5fff };
+  int palette_count = sizeof(palette) / sizeof(palette[0]);
+  int steps = 50;
+  uint32_t table[steps + 1];
+
+  struct bench bench;
+  bench_begin(&bench, "transition/srgb build (50 steps)");
+  for (int r = 0; r < rounds; r++) {
+    blend_color_steps(palette[r % palette_count],
+                      palette[(r + 1) % palette_count],
+                      table,
+                      steps                           );
+    g_sink += table[r % steps];
+  }
+  bench_end(&bench, rounds);
+
+  bench_begin(&bench, "transition/oklab build (50 steps)");
+  for (int r = 0; r < rounds; r++) {
+    oklab_color_steps(palette[r % palette_count],
+                      palette[(r + 1) % palette_count],
+                      table,
+                      steps                           );
+    g_sink += table[r % steps];
+  }
+  bench_end(&bench, rounds);
+
+  // Per frame both spaces read the same kind of table
+  uint32_t srgb[steps + 1], oklab[steps + 1];
+  blend_color_steps(palette[0], palette[1], srgb, steps);
+  oklab_color_steps(palette[0], palette[1], oklab, steps);
+  uint64_t frames = (uint64_t)rounds * 100;
+  bench_begin(&bench, "transition/srgb frame");
+  for (uint64_t i = 0; i < frames; i++) g_sink += srgb[i % (steps + 1)];
+  bench_end(&bench, frames);
+
+  bench_begin(&bench, "transition/oklab frame");
+  for (uint64_t i = 0; i < frames; i++) g_sink += oklab[i % (steps + 1)];
+  bench_end(&bench, frames);
+
+  // The previous per frame cost, before the transitions were tabulated
+  bench_begin(&bench, "transition/srgb frame (untabulated)");
+  for (uint64_t i = 0; i < frames; i++) {
+    g_sink += interpolate_color_value(palette[0], palette[1],
+                                      i % (steps + 1), steps );
+  }
+  bench_end(&bench, frames);
+}
+
+// The tables a track holds while it runs through its transitions, double
+// buffered and refilled in place, against interpolate_color_value computing
+// every step per frame: both the tables and the colors of frames landing on a
+// step have to match bit for bit.
+static uint64_t bench_transition_check(struct gradient_transition* transition) {
+  uint64_t mismatches = 0;
+  for (int step = 0; step <= transition->steps; step++) {
+    mismatches += transition->tl_colors[step]
+                  != interpolate_color_value(transition->from_tl_color,
+                                             transition->to_tl_color,
+                                             step,
+                                             transition->steps         );
+    mismatches += transition->br_colors[step]
+                  != interpolate_color_value(transition->from_br_color,
+                                             transition->to_br_color,
+                                             step,
+                                             transition->steps         );
+  }
+  return mismatches;
+}
+
+static void bench_transition_tables(int transitions) {
+  static uint32_t palette[] = { 0xffff5f87, 0xffffaf5f, 0xffd7ff5f,
+                                0xff5fffaf, 0xff5fafff, 0x00af5fff };
+  static const int steps[] = { 1, 7, 50, 301 };
+  static const int orders[] = { GRADIENT_ORDER_SEQUENTIAL,
+                                GRADIENT_ORDER_RANDOM      };
+  const uint64_t tick = 1000;
+  uint64_t mismatches = 0, frames = 0;
+
+  for (int s = 0; s < BENCH_COUNT(steps); s++) {
+    for (int o = 0; o < BENCH_COUNT(orders); o++) {
+      struct gradient_ticker ticker;
+      gradient_ticker_init(&ticker);
+      struct gradient_params params = {
+        .palette = palette,
+        .palette_count = sizeof(palette) / sizeof(palette[0]),
+        .order = orders[o],
+        .steps = steps[s],
+        .color_space = GRADIENT_SPACE_SRGB,
+        .period = steps[s] * tick
+      };
+      gradient_ticker_set(&ticker, 1, GRADIENT_TARGET_ACTIVE, &params, 7 + s);
+
+      // Every frame lands on a step, the frame colors are table entries
+      for (int t = 0; t < transitions; t++) {
+        for (int step = 0; step < steps[s]; step++) {
+          gradient_ticker_tick(&ticker, t * params.period + step * tick);
+          struct gradient_track* track = ticker.tracks[0];
+          struct gradient_transition* active
+                             = &track->transitions[track->active_transition];
+          struct gradient_transition* next
+                             = &track->transitions[track->active_transition ^ 1];
+          if (step == 0) {
+            mismatches += bench_transition_check(active);
+            mismatches += bench_transition_check(next);
+            mismatches += next->from_tl_color != active->to_tl_color
+                          || next->from_br_color != active->to_br_color;
+          }
+          mismatches += gradient_track_tl_color(track)
+                        != interpolate_color_value(active->from_tl_color,
+                                                   active->to_tl_color,
+                                                   step,
+                                                   active->steps          );
+          mismatches += gradient_track_br_color(track)
+                        != interpolate_color_value(active->from_br_color,
+                                                   active->to_br_color,
+                                                   step,
+                                                   active->steps          );
+          frames++;
+        }
+      }
+      gradient_ticker_free(&ticker);
+    }
+  }
+  printf("%-44s %10" PRIu64 " frames, %" PRIu64 " mismatches\n",
+         "transition/tables vs per frame", frames, mismatches);
+}
+
+// Drives a timeline with a fake 120 Hz clock in nanoseconds with jitter,
+// dropped frames and a multi-hour gap, and checks every position against the
+// elapsed time since the first frame
+static void bench_timeline(int frames) {
+  uint64_t period = 20ull * 1000000000ull;
+  uint64_t frame = 1000000000ull / 120;
+  struct timeline timeline;
+  timeline_init(&timeline, period, 0);
+
+  uint64_t now = 123456789ull;
+  uint64_t start = 0;
+  uint64_t latest = 0;
+  uint64_t last_transition = 0;
+  uint64_t errors = 0;
+  uint32_t state = 0x12345678;
+
+  struct bench bench;
+  bench_begin(&bench, "timeline/fake clock frame");
+  for (int i = 0; i < frames; i++) {
+    state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+    now += frame;
+    if (state % 50 == 0) now += frame * (1 + state % 5);  // Dropped frames
+    if (i == frames / 2) now += 3ull * 3600 * 1000000000ull + 12345; // Sleep
+
+    // Timestamps jitter by up to a millisecond around the nominal frame
+    uint64_t jitter = state % 2000000;
+    uint64_t timestamp = now + jitter > 1000000 ? now + jitter - 1000000 : 0;
+
+    uint64_t transition;
+    double progress;
+    timeline_position(&timeline, timestamp, &transition, &progress);
+
+    // The first frame starts the timeline
+    if (i == 0) start = latest = timestamp;
+    if (timestamp > latest) latest = timestamp;
+    uint64_t elapsed = latest - start;
+    double expected = (double)(elapsed % period) / period;
+    errors += transition != elapsed / period;
+    errors += progress < 0. || progress >= 1. || progress != expected;
+    errors += transition < last_transition;
+    last_transition = transition;
+  }
+  bench_end(&bench, frames);
+  printf("%-44s %10" PRIu64 " errors\n", "timeline/fake clock positions", errors);
+}
+
+// One ticker advancing many animated borders with a fake 120 Hz clock, the
+// tracks have different speeds and phase offsets
+static void bench_ticker(int tracks, int ticks) {
+  static uint32_t palette[] = { 0xffff5f87, 0xffffaf5f, 0xffd7ff5f,
+                                0xff5fffaf, 0xff5fafff, 0xffaf5fff };
+  uint64_t second = 1000000000ull;
+  struct gradient_ticker ticker;
+  gradient_ticker_init(&ticker);
+  for (int i = 0; i < tracks; i++) {
+    struct gradient_params params = {
+      .palette = palette,
+      .palette_count = sizeof(palette) / sizeof(palette[0]),
+      .steps = 50,
+      .color_space = GRADIENT_SPACE_SRGB,
+      .period = 20 * second / (1 + i % 3),
+      .phase = i * second / 7
+    };
+    gradient_ticker_set(&ticker, i + 1, GRADIENT_TARGET_ACTIVE, &params, 1 + i);
+  }
+
+  char name[64];
+  snprintf(name, sizeof(name), "gradient_ticker/tick tracks=%d", tracks);
+  uint64_t now = 0;
+  uint64_t changed = 0;
+  struct bench bench;
+  bench_begin(&bench, name);
+  for (int i = 0; i < ticks; i++) {
+    now += second / 120;
+    changed += gradient_ticker_tick(&ticker, now);
+  }
+  bench_end(&bench, ticks);
+  printf("%-44s %10.2f changed/tick\n", name, (double)changed / ticks);
+  gradient_ticker_free(&ticker);
+}
+
+// Collects the target pairs of the first transitions of a seeded track
+static void bench_sequence_pairs(int order, int palette_count, uint32_t seed, uint64_t* pairs, int count) {
+  static uint32_t palette[] = { 0xff000001, 0xff000002, 0xff000003,
+                                0xff000004, 0xff000005, 0xff000006,
+                                0xff000007 };
+  struct gradient_ticker ticker;
+  gradient_ticker_init(&ticker);
+  struct gradient_params params = { .palette = palette,
+                                    .palette_count = palette_count,
+                                    .order = order,
+                                    .seed = seed,
+                                    .steps = 4,
+                                    .period = 100                  };
+  gradient_ticker_set(&ticker, 1, GRADIENT_TARGET_ACTIVE, &params, seed);
+
+  struct gradient_track* track = ticker.tracks[0];
+  for (int i = 0; i < count; i++) {
+    gradient_ticker_tick(&ticker, (uint64_t)i * params.period);
+    struct gradient_transition* transition
+                             = &track->transitions[track->active_transition];
+    pairs[i] = ((uint64_t)transition->to_tl_color << 32)
+               | transition->to_br_color;
+  }
+  gradient_ticker_free(&ticker);
+}
+
+// Seeded sequences have to be reproducible, the colors of a pair have to
+// differ and a pair must never follow itself
+static void bench_sequence() {
+  static const char* orders[] = { "random", "sequential", "pingpong", "shuffle" };
+  int count = 2000;
+  uint64_t a[count], b[count];
+  for (int order = 0; order < 4; order++) {
+    uint64_t errors = 0;
+    for (int palette_count = 2; palette_count <= 7; palette_count++) {
+      for (uint32_t seed = 1; seed <= 8; seed++) {
+        bench_sequence_pairs(order, palette_count, seed, a, count);
+        bench_sequence_pairs(order, palette_count, seed, b, count);
+        for (int i = 0; i < count; i++) {
+          errors += a[i] != b[i];
+          errors += (a[i] >> 32) == (a[i] & 0xffffffff);
+          if (i > 0) errors += a[i] == a[i - 1];
+        }
+      }
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "gradient_sequence/%s", orders[order]);
+    printf("%-44s %10" PRIu64 " errors\n", name, errors);
+  }
+}
+
+// Simulates the main thread side of the animation with one focused and many
+// inactive windows and counts the redraws it causes, with the inactive tier
+// running at inactive_rate (0 redraws inactive borders with every change)
+static void bench_inactive_tier(int windows, double frame_rate, float inactive_rate, int seconds) {
+  static uint32_t palette[] = { 0xffff5f87, 0xffffaf5f, 0xffd7ff5f,
+                                0xff5fffaf, 0xff5fafff, 0xffaf5fff };
+  uint64_t second = 1000000000ull;
+  struct gradient_ticker ticker;
+  gradient_ticker_init(&ticker);
+  gradient_ticker_set_frame_rate(&ticker, frame_rate);
+
+  struct gradient_params params = {
+    .palette = palette,
+    .palette_count = sizeof(palette) / sizeof(palette[0]),
+    .steps = 50,
+    .period = 5 * second
+  };
+  gradient_ticker_set(&ticker, GRADIENT_TRACK_GLOBAL, GRADIENT_TARGET_ACTIVE, &params, 1);
+  params.rate = inactive_rate;
+  gradient_ticker_set(&ticker, GRADIENT_TRACK_GLOBAL, GRADIENT_TARGET_INACTIVE, &params, 2);
+
+  struct window { uint64_t colors; uint64_t next_frame; } window[windows];
+  memset(window, 0, sizeof(window));
+
+  uint64_t redraws = 0;
+  int max_frame_redraws = 0;
+  int frames = (int)(frame_rate * seconds);
+  for (int f = 0; f < frames; f++) {
+    if (!gradient_ticker_tick(&ticker, (uint64_t)(f * second / frame_rate))) continue;
+
+    int frame_redraws = 0;
+    for (int i = 0; i < ticker.count; i++) {
+      struct gradient_track* track = ticker.tracks[i];
+      if (track->target == GRADIENT_TARGET_ACTIVE) {
+        if (track->colors == track->applied_colors) continue;
+        track->applied_colors = track->colors;
+        frame_redraws++;  // The focused window
+        continue;
+      }
+
+      for (int w = 1; w < windows; w++) {
+        if (window[w].colors == track->colors) continue;
+        if (!gradient_tier_due(ticker.frame, &window[w].next_frame, w, track->divider)) continue;
+        window[w].colors = track->colors;
+        frame_redraws++;
+      }
+    }
+    redraws += frame_redraws;
+    if (frame_redraws > max_frame_redraws) max_frame_redraws = frame_redraws;
+  }
+
+  char name[64];
+  snprintf(name, sizeof(name), "inactive_tier/%d windows %.0f Hz tier=%.0f Hz",
+           windows, frame_rate, inactive_rate                            );
+  printf("%-44s %10.1f redraws/s %6d max/frame\n",
+         name, (double)redraws / seconds, max_frame_redraws);
+  gradient_ticker_free(&ticker);
+}
+
+// Replays a mock event sequence against the idle state machine of the
+// animation clock and compares the actions it takes
+static void bench_idle() {
+  uint64_t ms = 1000000ull;
+  struct step {
+    const char* event;
+    bool recheck;             // The scheduled recheck running
+    bool animated;
+    bool visible;
+    uint64_t now;
+    int action;
+  } steps[] = {
+    { "startup, nothing focused",      false, true,  false,    0 * ms, GRADIENT_IDLE_NONE },
+    { "focus animated window",         false, true,  true,    10 * ms, GRADIENT_IDLE_START },
+    { "focus moves between windows",   false, true,  true,    20 * ms, GRADIENT_IDLE_NONE },
+    { "space change hides it",         false, true,  false,   30 * ms, GRADIENT_IDLE_RECHECK },
+    { "space animation ends, visible", false, true,  true,   100 * ms, GRADIENT_IDLE_NONE },
+    { "window hidden again",           false, true,  false,  200 * ms, GRADIENT_IDLE_NONE },
+    { "recheck within grace",          true,  true,  false,  280 * ms, GRADIENT_IDLE_RECHECK },
+    { "focus event within grace",      false, true,  false,  300 * ms, GRADIENT_IDLE_NONE },
+    { "spawn event within grace",      false, true,  false,  350 * ms, GRADIENT_IDLE_NONE },
+    { "recheck after grace",           true,  true,  false,  530 * ms, GRADIENT_IDLE_STOP },
+    { "event while suspended",         false, true,  false,  700 * ms, GRADIENT_IDLE_NONE },
+    { "window unhidden",               false, true,  true,   900 * ms, GRADIENT_IDLE_START },
+    { "animation turned off",          false, false, true,  1000 * ms, GRADIENT_IDLE_STOP },
+    { "focus while off",               false, false, true,  1100 * ms, GRADIENT_IDLE_NONE },
+    { "animation turned on",           false, true,  true,  1200 * ms, GRADIENT_IDLE_START },
+  };
+
+  struct gradient_idle idle;
+  gradient_idle_init(&idle, 250 * ms);
+  uint64_t errors = 0;
+  for (int i = 0; i < BENCH_COUNT(steps); i++) {
+    if (steps[i].recheck) gradient_idle_rechecked(&idle);
+    int action = gradient_idle_update(&idle,
+                                      steps[i].animated,
+                                      steps[i].visible,
+                                      steps[i].now     );
+    if (action != steps[i].action) {
+      printf("idle: '%s' took %d, expected %d\n", steps[i].event,
+                                                   action,
+                                                   steps[i].action);
+      errors++;
+    }
+  }
+  errors += idle.starts != 3 || idle.suspends != 1 || idle.recheck_pending;
+
+  // A burst of events during the grace schedules a single recheck
+  int rechecks = 0;
+  gradient_idle_init(&idle, 250 * ms);
+  gradient_idle_update(&idle, true, true, 0);
+  for (uint64_t now = 1; now < 1000; now++) {
+    rechecks += gradient_idle_update(&idle, true, false, now * ms / 10)
+                == GRADIENT_IDLE_RECHECK;
+  }
+  errors += rechecks != 1;
+  printf("%-44s %10" PRIu64 " errors\n", "gradient_idle/mock events", errors);
+}
+
+// Compares the table backed endpoints with exact trigonometry, and counts
+// the frames of a rotating track which only change the angle (no new
+// gradient object) against those which change the colors
+static void bench_rotation(int rounds) {
+  double width = 1200, height = 800, max_error = 0;
+  double start[2], end[2];
+  for (uint32_t angle = 0; angle < ANGLE_STEPS; angle++) {
+    angle_line_endpoints(angle, width, height, start, end);
+    double theta = 2.0 * M_PI * angle / ANGLE_STEPS;
+    double dx = sin(theta), dy = cos(theta);
+    double half = (fabs(width * dx) + fabs(height * dy)) / 2.0;
+    double exact[4] = { width / 2 - dx * half, height / 2 - dy * half,
+                        width / 2 + dx * half, height / 2 + dy * half };
+    double got[4] = { start[0], start[1], end[0], end[1] };
+    for (int i = 0; i < 4; i++) {
+      if (fabs(got[i] - exact[i]) > max_error) max_error = fabs(got[i] - exact[i]);
+    }
+  }
+
+  // 135 degrees on a square runs from the top left to the bottom right corner
+  angle_line_endpoints(angle_from_degrees(135), 100, 100, start, end);
+  uint64_t errors = fabs(start[0]) > 1e-3 || fabs(start[1] - 100) > 1e-3
+                    || fabs(end[0] - 100) > 1e-3 || fabs(end[1]) > 1e-3;
+  errors += angle_from_degrees(-90) != angle_from_degrees(270);
+  printf("%-44s %10.2e px max error, %" PRIu64 " errors\n",
+         "angle/endpoints", max_error, errors);
+
+  struct bench bench;
+  bench_begin(&bench, "angle/endpoints per frame");
+  for (int r = 0; r < rounds; r++) {
+    angle_line_endpoints(r & ANGLE_MASK, width, height, start, end);
+    g_sink += (uintptr_t)start[0];
+  }
+  bench_end(&bench, rounds);
+
+  static uint32_t palette[] = { 0xffff5f87, 0xffffaf5f, 0xff5fafff };
+  uint64_t second = 1000000000ull;
+  struct gradient_ticker ticker;
+  gradient_ticker_init(&ticker);
+  struct gradient_params params = {
+    .palette = palette,
+    .palette_count = sizeof(palette) / sizeof(palette[0]),
+    .steps = 50,
+    .period = 20 * second,
+    .angled = true,
+    .angle = angle_from_degrees(135),
+    .rotation_period = 10 * second
+  };
+  gradient_ticker_set(&ticker, 1, GRADIENT_TARGET_ACTIVE, &params, 1);
+  struct gradient_track* track = ticker.tracks[0];
+
+  uint64_t frames = 0, rebuilds = 0, rotations = 0, colors = 0;
+  uint32_t angle = track->angle;
+  for (int f = 0; f < 60 * 20; f++) {
+    if (!gradient_ticker_tick(&ticker, (uint64_t)f * second / 60)) continue;
+    frames++;
+    if (track->colors != colors) rebuilds++;
+    else rotations++;
+    colors = track->colors;
+    angle = track->angle;
+  }
+  errors = angle != ((params.angle + ANGLE_STEPS * 1199 / 600) & ANGLE_MASK);
+  gradient_ticker_free(&ticker);
+  printf("%-44s %10" PRIu64 " redraws, %" PRIu64 " rotation only, %" PRIu64 " errors\n",
+         "angle/rotating track 20s@60Hz", frames, rotations, errors);
+}
+
+// Swaps palettes from the main thread while a ticker thread runs flat out.
+// Every palette tags its colors with its own alpha, so a tick blending the
+// colors of a released or half published palette shows up as a mismatch.
+struct bench_swap {
+  struct gradient_ticker* ticker;
+  atomic_bool stop;
+  atomic_uint_fast64_t ticks;
+  uint64_t swaps;
+  uint64_t errors;
+};
+
+static void* bench_swap_ticker(void* context) {
+  struct bench_swap* swap = context;
+  struct gradient_ticker* ticker = swap->ticker;
+  struct gradient_snapshot* snapshot = NULL;
+  uint64_t now = 0;
+  while (!atomic_load(&swap->stop)) {
+    gradient_ticker_tick(ticker, now += 1000);
+    struct gradient_track* track = ticker->tracks[0];
+    if (track->snapshot != snapshot) swap->swaps++;
+    snapshot = track->snapshot;
+
+    uint32_t tag = snapshot->palette[0] >> 24;
+    swap->errors += gradient_track_tl_color(track) >> 24 != tag
+                    || gradient_track_br_color(track) >> 24 != tag;
+    atomic_fetch_add(&swap->ticks, 1);
+    sched_yield();
+  }
+  return NULL;
+}
+
+static void bench_swap(int publishes) {
+  struct gradient_ticker ticker;
+  gradient_ticker_init(&ticker);
+  uint32_t palette[6];
+  struct gradient_params params = { .palette = palette,
+                                    .palette_count = 2,
+                                    .steps = 8,
+                                    .period = 100000 };
+  for (int i = 0; i < 6; i++) palette[i] = 0x80000000 | (i * 0x2a2a2a);
+  gradient_ticker_set(&ticker, 1, GRADIENT_TARGET_ACTIVE, &params, 1);
+
+  struct bench_swap swap = { .ticker = &ticker };
+  atomic_init(&swap.stop, false);
+  atomic_init(&swap.ticks, 0);
+  pthread_t thread;
+  pthread_create(&thread, NULL, bench_swap_ticker, &swap);
+
+  struct bench bench;
+  bench_begin(&bench, "gradient_ticker/publish, every other awaited");
+  for (int p = 0; p < publishes; p++) {
+    uint32_t tag = (0x81 + p % 0x7f) << 24;
+    params.palette_count = 2 + p % 5;
+    params.steps = 4 + p % 13;
+    for (int i = 0; i < params.palette_count; i++) {
+      palette[i] = tag | ((uint32_t)(p + i) * 0x2a2a2a & 0xffffff);
+    }
+    gradient_ticker_set(&ticker, 1, GRADIENT_TARGET_ACTIVE, &params, p);
+
+    // Every other publication waits for a tick, the ones in between are
+    // replaced before the ticker gets to see them
+    uint64_t ticks = atomic_load(&swap.ticks);
+    while (p % 2 && atomic_load(&swap.ticks) == ticks) sched_yield();
+  }
+  bench_end(&bench, publishes);
+
+  atomic_store(&swap.stop, true);
+  pthread_join(thread, NULL);
+
+  // The last publication is picked up by the next tick
+  gradient_ticker_tick(&ticker, UINT64_MAX / 2);
+  struct gradient_track* track = ticker.tracks[0];
+  swap.errors += track->snapshot != track->published
+                 || track->params.palette_count != params.palette_count
+                 || track->params.palette[0] != palette[0];
+  gradient_ticker_free(&ticker);
+  printf("%-44s %10" PRIu64 " ticks, %" PRIu64 " swaps, %" PRIu64 " errors\n",
+         "gradient_ticker/palette swaps", (uint64_t)atomic_load(&swap.ticks), swap.swaps, swap.errors);
+}
+
+// Compares the interpolated easing tables with solving the curve exactly at
+// every frame, and what each costs per frame
+static double bench_easing_exact(double x1, double y1, double x2, double y2, double x) {
+  double low = 0.0, high = 1.0, t = 0.5;
+  for (int i = 0; i < 100; i++) {
+    t = (low + high) / 2.0;
+    double u = 1.0 - t;
+    double value = 3 * u * u * t * x1 + 3 * u * t * t * x2 + t * t * t;
+    if (value < x) low = t;
+    else high = t;
+  }
+  double u = 1.0 - t;
+  double y = 3 * u * u * t * y1 + 3 * u * t * t * y2 + t * t * t;
+  return y < 0 ? 0 : (y > 1 ? 1 : y);
+}
+
+static void bench_easing(int rounds) {
+  struct easing curves[] = {
+    { .type = EASING_EASE_IN_OUT },
+    { .type = EASING_CUBIC_BEZIER, .x1 = 0.25f, .y1 = 0.1f, .x2 = 0.25f, .y2 = 1.f },
+    { .type = EASING_CUBIC_BEZIER, .x1 = 0.f, .y1 = 0.f, .x2 = 1.f, .y2 = 1.f },
+    { .type = EASING_CUBIC_BEZIER, .x1 = 0.68f, .y1 = -0.55f, .x2 = 0.27f, .y2 = 1.55f },
+  };
+  static uint32_t table[EASING_STEPS + 1];
+  double max_error = 0;
+  uint64_t errors = 0;
+  for (int c = 0; c < BENCH_COUNT(curves); c++) {
+    struct easing* curve = &curves[c];
+    easing_build_table(curve, table);
+    errors += table[0] != 0 || table[EASING_STEPS] != EASING_ONE;
+    double x1 = 0.42, y1 = 0, x2 = 0.58, y2 = 1;
+    if (curve->type == EASING_CUBIC_BEZIER) {
+      x1 = curve->x1, y1 = curve->y1, x2 = curve->x2, y2 = curve->y2;
+    }
+    for (int i = 0; i < 10000; i++) {
+      double x = (i + 0.37) / 10000;
+      double error = fabs(easing_apply(table, x)
+                          - bench_easing_exact(x1, y1, x2, y2, x));
+      if (error > max_error) max_error = error;
+    }
+  }
+  printf("%-44s %10.2e max error, %" PRIu64 " errors\n",
+         "easing/table vs exact curve", max_error, errors);
+
+  easing_build_table(&curves[0], table);
+  struct bench bench;
+  bench_begin(&bench, "easing/table lookup per frame");
+  double sum = 0;
+  for (int r = 0; r < rounds; r++) sum += easing_apply(table, (r % 997) / 997.0);
+  bench_end(&bench, rounds);
+
+  bench_begin(&bench, "easing/solving the curve per frame");
+  for (int r = 0; r < rounds; r++) {
+    sum += bench_easing_exact(0.42, 0, 0.58, 1, (r % 997) / 997.0);
+  }
+  bench_end(&bench, rounds);
+  g_sink += (uintptr_t)sum;
+}
+
+// Subscribes many animations with mixed dividers to the shared ticker, driven
+// by the timerfd clock, and checks every subscriber ran on its share of the
+// frames. Reports the wakeup jitter and the CPU time the ticker took.
+struct bench_subscriber {
+  struct animation animation;
+  uint64_t runs;
+  uint64_t last_time;
+  uint64_t max_late;
+};
+
+static void bench_subscriber_proc(struct animation* animation, uint64_t time) {
+  struct bench_subscriber* subscriber = animation->context;
+  if (subscriber->last_time && animation->divider == 1) {
+    uint64_t interval = time - subscriber->last_time;
+    uint64_t period = (uint64_t)(animation->frame_time * 1000.0);
+    if (interval > period && interval - period > subscriber->max_late) {
+      subscriber->max_late = interval - period;
+    }
+  }
+  subscriber->last_time = time;
+  subscriber->runs++;
+}
+
+static uint64_t bench_cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void bench_animation_ticker(int count, double rate, double seconds) {
+  struct bench_subscriber* subscribers = calloc(count, sizeof(struct bench_subscriber));
+  animation_ticker_set_clock(&g_clock_timerfd, rate);
+
+  uint64_t cpu = bench_cpu_ns();
+  uint64_t first_frame = animation_ticker_frames();
+  for (int i = 0; i < count; i++) {
+    animation_init(&subscribers[i].animation);
+    subscribers[i].animation.divider = 1 + i % 4;
+    animation_start(&subscribers[i].animation, bench_subscriber_proc, &subscribers[i]);
+  }
+  usleep((useconds_t)(seconds * 1e6));
+  for (int i = 0; i < count; i++) animation_stop(&subscribers[i].animation);
+  uint64_t frames = animation_ticker_frames() - first_frame;
+  cpu = bench_cpu_ns() - cpu;
+
+  uint64_t errors = animation_ticker_subscribers() != 0;
+  uint64_t runs = 0, max_late = 0;
+  for (int i = 0; i < count; i++) {
+    uint64_t divider = subscribers[i].animation.divider;
+    runs += subscribers[i].runs;
+    if (subscribers[i].runs + 1 < frames / divider
+        || subscribers[i].runs > frames / divider + 1) {
+      errors++;
+    }
+    if (subscribers[i].max_late > max_late) max_late = subscribers[i].max_late;
+  }
+
+  char name[64];
+  snprintf(name, sizeof(name), "animation_ticker/%d subscribers %.0f Hz", count, rate);
+  printf("%-44s %10" PRIu64 " frames, %.1f runs/frame, %" PRIu64 " errors\n",
+         name, frames, frames ? (double)runs / frames : 0.0, errors);
+  printf("%-44s %10.2f us/frame cpu, %.2f ms max late\n",
+         name, frames ? cpu / 1000.0 / frames : 0.0, max_late / 1e6);
+  animation_ticker_set_clock(NULL, 0);
+  free(subscribers);
+}
+
+// The gradient frame pipeline of the animation callback, run headless on the
+// virtual clock for millions of frames. The ticks run gradient_frame_tick like
+// the callback, the blocks go to a fake main queue which runs
+// gradient_frame_dequeue only every few frames, as when the main thread is
+// busy, and the transition of the track is checked against the virtual time.
+struct bench_pipeline {
+  struct animation animation;
+  struct gradient_ticker ticker;
+  struct gradient_dispatch dispatch;
+  struct gradient_pacing pacing;
+  struct gradient_track* track;
+  uint64_t period;
+  int drain_every;
+  int blocks;               // Blocks waiting on the fake main queue
+  uint64_t frames;
+  uint64_t start;
+  uint64_t latest;
+  uint64_t first_vsync;
+  uint64_t last_vsync;
+  uint64_t errors;
+};
+
+static void bench_pipeline_proc(struct animation* animation, uint64_t time) {
+  struct bench_pipeline* pipeline = animation->context;
+  uint64_t frame_period = (uint64_t)(animation->frame_time * 1e3);
+  if (gradient_frame_tick(&pipeline->dispatch,
+                          &pipeline->pacing,
+                          &pipeline->ticker,
+                          time,
+                          (uint64_t)(time * (1e9 / animation->frequency)),
+                          frame_period,
+                          pipeline->frames + 1                            )) {
+    pipeline->blocks++;
+  }
+
+  // The jitter stays below half a frame, so the vsync of a tick is exact
+  uint64_t vsync = (time + frame_period / 2) / frame_period;
+  if (!pipeline->first_vsync) pipeline->first_vsync = vsync;
+  pipeline->last_vsync = vsync;
+
+  if (pipeline->frames++ == 0) pipeline->start = pipeline->latest = time;
+  if (time > pipeline->latest) pipeline->latest = time;
+  uint64_t expected = (pipeline->latest - pipeline->start) / pipeline->period;
+  pipeline->errors += pipeline->track->transition_index != expected;
+
+  // Latency is counted in frames here, the draw is the read of the colors
+  if (pipeline->frames % pipeline->drain_every == 0 && pipeline->blocks) {
+    gradient_frame_dequeue(&pipeline->dispatch, &pipeline->pacing, pipeline->frames);
+    gradient_pacing_drawn(&pipeline->pacing, pipeline->frames, pipeline->frames);
+    g_sink += gradient_track_tl_color(pipeline->track)
+              ^ gradient_track_br_color(pipeline->track);
+    pipeline->blocks--;
+  }
+}
+
+static void bench_pipeline(double rate, double jitter, double drop, int drain_every, uint64_t vsyncs) {
+  static uint32_t palette[] = { 0xffff5f87, 0xffffaf5f, 0xffd7ff5f,
+                                0xff5fffaf, 0xff5fafff, 0xffaf5fff };
+  struct bench_pipeline pipeline = { .drain_every = drain_every,
+                                     .period = 3 * 1000000000ull };
+  gradient_ticker_init(&pipeline.ticker);
+  gradient_ticker_set_frame_rate(&pipeline.ticker, rate);
+  gradient_dispatch_reset(&pipeline.dispatch);
+  gradient_pacing_reset(&pipeline.pacing);
+  struct gradient_params params = {
+    .palette = palette,
+    .palette_count = sizeof(palette) / sizeof(palette[0]),
+    .steps = 50,
+    .color_space = GRADIENT_SPACE_SRGB,
+    .period = pipeline.period
+  };
+  gradient_ticker_set(&pipeline.ticker, 1, GRADIENT_TARGET_ACTIVE, &params, 7);
+  pipeline.track = pipeline.ticker.tracks[0];
+
+  clock_virtual_configure(jitter, drop, 0x2545f491);
+  animation_ticker_set_clock(&g_clock_virtual, rate);
+  animation_init(&pipeline.animation);
+  animation_start(&pipeline.animation, bench_pipeline_proc, &pipeline);
+
+  char name[64];
+  snprintf(name, sizeof(name), "pipeline/%.0f Hz jitter=%.2f drop=%.2f",
+           rate, jitter, drop);
+  struct bench bench;
+  bench_begin(&bench, name);
+  uint64_t frames = clock_virtual_run(vsyncs);
+  bench_end(&bench, frames);
+  animation_stop(&pipeline.animation);
+  animation_ticker_set_clock(NULL, 0);
+
+  struct gradient_dispatch* dispatch = &pipeline.dispatch;
+  uint64_t dispatched = atomic_load(&dispatch->dispatched);
+  uint64_t coalesced = atomic_load(&dispatch->coalesced);
+  uint64_t unchanged = atomic_load(&dispatch->unchanged);
+  uint64_t errors = pipeline.errors
+                    + (dispatched + coalesced + unchanged != frames)
+                    + (atomic_load(&dispatch->max_queue_depth) > 1);
+  printf("%-44s %10" PRIu64 " dispatched, %" PRIu64 " coalesced, %"
+         PRIu64 " unchanged, %" PRIu64 " errors\n",
+         name, dispatched, coalesced, unchanged, errors);
+
+  // The pacing histograms see every tick, the vsyncs dropped between the
+  // first and the last one and jitter of at most twice the offset
+  struct gradient_pacing* pacing = &pipeline.pacing;
+  uint64_t missed = atomic_load(&pacing->missed.sum);
+  uint64_t dropped = pipeline.last_vsync - pipeline.first_vsync + 1 - frames;
+  uint64_t max_jitter = (uint64_t)(2.0 * jitter * 1e9 / rate) + 1;
+  uint64_t pacing_errors = (atomic_load(&pacing->missed.count) != frames - 1)
+                           + (missed != dropped)
+                           + (atomic_load(&pacing->jitter.max) > max_jitter)
+                           + (atomic_load(&pacing->latency.max)
+                              > (uint64_t)drain_every)
+                           + (atomic_load(&pacing->draw.count)
+                              != atomic_load(&pacing->latency.count));
+  printf("%-44s %10.2f us p99 jitter, %" PRIu64 " missed, %"
+         PRIu64 " errors\n",
+         name, histogram_percentile(&pacing->jitter, 0.99) / 1e3,
+         missed, pacing_errors);
+  gradient_ticker_free(&pipeline.ticker);
+}
+
+// Records known distributions into one histogram from several threads at
+// once and checks the counts and the percentiles against the exact ones
+struct bench_histogram_thread {
+  pthread_t thread;
+  struct histogram* histogram;
+  uint64_t* values;
+  int count;
+};
+
+static void* bench_histogram_proc(void* context) {
+  struct bench_histogram_thread* thread = context;
+  for (int i = 0; i < thread->count; i++) {
+    histogram_record(thread->histogram, thread->values[i]);
+  }
+  return NULL;
+}
+
+static int bench_compare_u64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+static void bench_histogram(int threads, int per_thread) {
+  static struct histogram histogram;
+  histogram_reset(&histogram);
+
+  int count = threads * per_thread;
+  uint64_t* values = malloc(sizeof(uint64_t) * count);
+  uint32_t state = 0x6a09e667;
+  for (int i = 0; i < count; i++) {
+    // Log uniform from nanoseconds up to seconds, like frame timings
+    state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+    int exponent = state % 31;
+    values[i] = (1ull << exponent) + state % (1ull << exponent);
+  }
+
+  uint64_t errors = 0;
+  for (int i = 1; i < HISTOGRAM_BUCKETS; i++) {
+    uint64_t low = histogram_bucket_low(i);
+    errors += low <= histogram_bucket_low(i - 1);
+    errors += histogram_bucket(low) != i || histogram_bucket(low - 1) != i - 1;
+  }
+  errors += histogram_bucket(UINT64_MAX) != HISTOGRAM_BUCKETS - 1;
+
+  struct bench_histogram_thread workers[threads];
+  struct bench bench;
+  bench_begin(&bench, "histogram/record contended");
+  for (int i = 0; i < threads; i++) {
+    workers[i] = (struct bench_histogram_thread){ .histogram = &histogram,
+                                                  .values = values + i * per_thread,
+                                                  .count = per_thread };
+    pthread_create(&workers[i].thread, NULL, bench_histogram_proc, &workers[i]);
+  }
+  for (int i = 0; i < threads; i++) pthread_join(workers[i].thread, NULL);
+  bench_end(&bench, count);
+
+  qsort(values, count, sizeof(uint64_t), bench_compare_u64);
+  uint64_t sum = 0;
+  for (int i = 0; i < count; i++) sum += values[i];
+  errors += atomic_load(&histogram.count) != (uint64_t)count;
+  errors += atomic_load(&histogram.sum) != sum;
+  errors += atomic_load(&histogram.max) != values[count - 1];
+
+  double max_error = 0;
+  static const double fractions[] = { 0.01, 0.25, 0.5, 0.9, 0.99, 0.999 };
+  for (int i = 0; i < BENCH_COUNT(fractions); i++) {
+    uint64_t exact = values[(int)(fractions[i] * count + 0.5) - 1];
+    double error = fabs((double)histogram_percentile(&histogram, fractions[i])
+                        - exact) / exact;
+    if (error > max_error) max_error = error;
+  }
+  errors += max_error > 1.0 / (1 << HISTOGRAM_SUB_BITS);
+  printf("%-44s %10.2e max percentile error, %" PRIu64 " errors\n",
+         "histogram/percentiles", max_error, errors);
+  free(values);
+}
+
+// The gradient cache with a stub object in place of CGGradientRef: objects
+// count their references and the live objects are tracked, so leaks, early
+// frees and mismatched colors show up as errors.
+struct bench_gradient {
+  atomic_int refs;
+  uint32_t color1;
+  uint32_t color2;
+  int space;
+};
+
+static atomic_int g_bench_gradients_live;
+
+static GRADIENT_CACHE_CREATE(bench_gradient_create) {
+  struct bench_gradient* gradient = malloc(sizeof(struct bench_gradient));
+  atomic_init(&gradient->refs, 1);
+  gradient->color1 = color1;
+  gradient->color2 = color2;
+  gradient->space = space;
+  atomic_fetch_add(&g_bench_gradients_live, 1);
+  return gradient;
+}
+
+static GRADIENT_CACHE_REFCOUNT(bench_gradient_retain) {
+  struct bench_gradient* gradient = object;
+  atomic_fetch_add(&gradient->refs, 1);
+}
+
+static GRADIENT_CACHE_REFCOUNT(bench_gradient_release) {
+  struct bench_gradient* gradient = object;
+  if (atomic_fetch_sub(&gradient->refs, 1) == 1) {
+    atomic_fetch_sub(&g_bench_gradients_live, 1);
+    free(gradient);
+  }
+}
+
+static bool bench_gradient_matches(struct bench_gradient* gradient, uint32_t color1, uint32_t color2, int space) {
+  return gradient
+         && atomic_load(&gradient->refs) > 0
+         && gradient->color1 == color1
+         && gradient->color2 == color2
+         && gradient->space == space;
+}
+
+struct bench_cache_thread {
+  pthread_t thread;
+  struct gradient_cache* cache;
+  uint32_t seed;
+  int gets;
+  uint64_t errors;
+};
+
+static void* bench_cache_proc(void* context) {
+  struct bench_cache_thread* thread = context;
+  uint32_t state = thread->seed;
+  for (int i = 0; i < thread->gets; i++) {
+    state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+    uint32_t color = 0xff000000 | (state % 24);
+    int space = (state >> 8) & 1;
+    struct bench_gradient* gradient = gradient_cache_get(thread->cache,
+                                                         color,
+                                                         ~color,
+                                                         space           );
+    if (i % 64 == 0) sched_yield();
+    thread->errors += !bench_gradient_matches(gradient, color, ~color, space);
+    bench_gradient_release(gradient);
+  }
+  return NULL;
+}
+
+static void bench_gradient_cache(int borders, int frames) {
+  struct gradient_cache cache;
+  uint64_t errors = 0;
+  uint64_t hits, misses, evictions;
+
+  // Recency order: the least recently used entry goes first, an entry still
+  // held by a draw survives its eviction
+  gradient_cache_init(&cache, 4, bench_gradient_create,
+                      bench_gradient_retain, bench_gradient_release);
+  struct bench_gradient* held = gradient_cache_get(&cache, 1, 1, 0);
+  for (uint32_t i = 2; i <= 4; i++) {
+    bench_gradient_release(gradient_cache_get(&cache, i, i, 0));
+  }
+  bench_gradient_release(gradient_cache_get(&cache, 2, 2, 0));
+  bench_gradient_release(gradient_cache_get(&cache, 5, 5, 0));
+  bench_gradient_release(gradient_cache_get(&cache, 6, 6, 0));
+  errors += !bench_gradient_matches(held, 1, 1, 0);
+  bench_gradient_release(held);
+  struct bench_gradient* kept = gradient_cache_get(&cache, 2, 2, 0);
+  struct bench_gradient* other = gradient_cache_get(&cache, 2, 2, 1);
+  errors += kept == other || !bench_gradient_matches(other, 2, 2, 1);
+  bench_gradient_release(kept);
+  bench_gradient_release(other);
+  gradient_cache_stats(&cache, &hits, &misses, &evictions);
+  errors += hits != 2 || misses != 7 || evictions != 3;
+  gradient_cache_free(&cache);
+  errors += atomic_load(&g_bench_gradients_live) != 0;
+
+  // Threads drawing with twice as many gradients as fit
+  gradient_cache_init(&cache, 24, bench_gradient_create,
+                      bench_gradient_retain, bench_gradient_release);
+  struct bench_cache_thread threads[4];
+  for (int i = 0; i < 4; i++) {
+    threads[i] = (struct bench_cache_thread){ .cache = &cache,
+                                              .seed = 0x1234567 * (i + 1),
+                                              .gets = 200000 };
+    pthread_create(&threads[i].thread, NULL, bench_cache_proc, &threads[i]);
+  }
+  for (int i = 0; i < 4; i++) {
+    pthread_join(threads[i].thread, NULL);
+    errors += threads[i].errors;
+  }
+  gradient_cache_stats(&cache, &hits, &misses, &evictions);
+  errors += hits + misses != 4 * 200000;
+  gradient_cache_free(&cache);
+  errors += atomic_load(&g_bench_gradients_live) != 0;
+  printf("%-44s %10.1f%% hits contended, %" PRIu64 " errors\n",
+         "gradient_cache/lru and refcounts",
+         100.0 * hits / (hits + misses), errors);
+
+  // Animated frames: every border following the settings is redrawn with
+  // the same colors, only the first of them creates the gradient
+  gradient_cache_init(&cache, GRADIENT_CACHE_CAPACITY, bench_gradient_create,
+                      bench_gradient_retain, bench_gradient_release);
+  char name[64];
+  snprintf(name, sizeof(name), "gradient_cache/frame borders=%d", borders);
+  struct bench bench;
+  bench_begin(&bench, name);
+  for (int frame = 0; frame < frames; frame++) {
+    uint32_t color1 = 0xff000000 | (frame * 2654435761u >> 8);
+    for (int i = 0; i < borders; i++) {
+      void* gradient = gradient_cache_get(&cache, color1, ~color1,
+                                          GRADIENT_CACHE_SRGB     );
+      g_sink += (uintptr_t)gradient;
+      bench_gradient_release(gradient);
+    }
+  }
+  bench_end(&bench, (uint64_t)frames * borders);
+  gradient_cache_stats(&cache, &hits, &misses, &evictions);
+  printf("%-44s %10" PRIu64 " created for %" PRIu64 " draws\n",
+         name, misses, hits + misses);
+  gradient_cache_free(&cache);
+}
+
+int main(void) {
+  bench_windows(100, 20000);
+  bench_windows(1000, 2000);
+  bench_windows(10000, 200);
+  bench_insert_latency(100000, 10);
+  bench_wid_table_readers(1, 200000, 200000);
+  bench_wid_table_readers(4, 200000, 200000);
+  bench_blacklist(false, 10000);
+  bench_blacklist(true, 10000);
+  bench_space_index(64, 200000);
+  bench_parse(100000);
+  bench_interpolate(200000);
+  bench_blend(4096, 40);
+  bench_color_space(200000);
+  bench_transition_tables(40);
+  bench_timeline(1000000);
+  bench_easing(1000000);
+  bench_ticker(1, 200000);
+  bench_ticker(32, 20000);
+  bench_sequence();
+  bench_swap(100000);
+  bench_idle();
+  bench_rotation(1000000);
+  bench_animation_ticker(100, 60., 1.0);
+  bench_animation_ticker(500, 240., 1.0);
+  bench_histogram(4, 500000);
+  bench_gradient_cache(50, 20000);
+  bench_pipeline(60., 0.0, 0.0, 1, 2000000);
+  bench_pipeline(120., 0.1, 0.01, 3, 2000000);
+  bench_pipeline(240., 0.25, 0.05, 8, 2000000);
+  bench_inactive_tier(50, 60., 0.f, 20);
+  bench_inactive_tier(50, 60., 10.f, 20);
+  bench_inactive_tier(50, 120., 0.f, 20);
+  bench_inactive_tier(50, 120., 10.f, 20);
+  return 0;
+}
@@ -0,0 +1,33 @@
+#include "angle.h"
+#include <math.h>
+#include <pthread.h>
+
+// One entry per step of a turn, the cosine reads the sine a quarter turn on
+static float g_sin[ANGLE_STEPS];
+static pthread_once_t g_table_once = PTHREAD_ONCE_INIT;
+
+static void angle_init_table() {
+  for (int i = 0; i < ANGLE_STEPS; i++) {
+    g_sin[i] = sin(2.0 * M_PI * i / ANGLE_STEPS);
+  }
+}
+
+uint32_t angle_from_degrees(double degrees) {
+  double turns = degrees / 360.0;
+  turns -= floor(turns);
+  return (uint32_t)(turns * ANGLE_STEPS + 0.5) & ANGLE_MASK;
+}
+
+void angle_line_endpoints(uint32_t angle, double width, double height, double start[2], double end[2]) {
+  pthread_once(&g_table_once, angle_init_table);
+  double dx = g_sin[angle & ANGLE_MASK];
+  double dy = g_sin[(angle + ANGLE_STEPS / 4) & ANGLE_MASK];
+
+  // Projection of the frame onto the direction, half of it on either side
+  // of the center
+  double half = (fabs(width * dx) + fabs(height * dy)) / 2.0;
+  start[0] = width / 2.0 - dx * half;
+  start[1] = height / 2.0 - dy * half;
+  end[0] = width / 2.0 + dx * half;
+  end[1] = height / 2.0 + dy * half;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+
+// Gradient angles in fixed point, ANGLE_STEPS make a full turn. An angle is
+// measured clockwise from pointing up: 0 runs bottom to top, a quarter turn
+// left to right. The direction vectors are backed by a sin/cos table.
+#define ANGLE_STEPS 4096
+#define ANGLE_MASK (ANGLE_STEPS - 1)
+
+uint32_t angle_from_degrees(double degrees);
+
+// Start and end point of the gradient line of angle in a width x height frame
+// with the y axis pointing up. The line passes through the center and is just
+// long enough for the first and last color to reach the opposite corners.
+void angle_line_endpoints(uint32_t angle, double width, double height, double start[2], double end[2]);
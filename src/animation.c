@@ -1,35 +1,144 @@
 #include "animation.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct animation_ticker {
+  pthread_mutex_t mutex;        // Guards the subscribers, held while they run
+  pthread_mutex_t clock_mutex;  // Serializes starting and stopping the clock
+  struct animation** subscribers;
+  int count;
+  int capacity;
+  uint32_t next_slot;
+  uint64_t frame;
+  struct clock clock;
+};
+
+static struct animation_ticker g_ticker = {
+  .mutex = PTHREAD_MUTEX_INITIALIZER,
+  .clock_mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+static void animation_clock_proc(struct clock* clock, uint64_t time) {
+  (void)clock;
+  animation_ticker_tick(time);
+}
+
+static inline bool animation_due(struct animation* animation, uint64_t frame) {
+  return animation->divider <= 1
+         || (frame + animation->slot) % animation->divider == 0;
+}
 
 void animation_init(struct animation* animation) {
   memset(animation, 0, sizeof(struct animation));
+  animation->divider = 1;
 }
 
+void animation_set_divider(struct animation* animation, uint32_t divider) {
+  pthread_mutex_lock(&g_ticker.mutex);
+  animation->divider = divider > 0 ? divider : 1;
+  pthread_mutex_unlock(&g_ticker.mutex);
+}
+
+void animation_ticker_set_clock(const struct clock_backend* backend, double rate) {
+  pthread_mutex_lock(&g_ticker.clock_mutex);
+  g_ticker.clock.backend = backend;
+  g_ticker.clock.rate = rate;
+  pthread_mutex_unlock(&g_ticker.clock_mutex);
+}
+
+void animation_ticker_tick(uint64_t time) {
+  pthread_mutex_lock(&g_ticker.mutex);
+  uint64_t frame = ++g_ticker.frame;
+  float delay = 0.f;
+  for (int i = 0; i < g_ticker.count; i++) {
+    struct animation* animation = g_ticker.subscribers[i];
+    if (!animation_due(animation, frame)) continue;
+    if (animation->delay > 0.f) {
+      if (animation->delay > delay) delay = animation->delay;
+      continue;
+    }
+    animation->proc(animation, time);
+  }
+
+  // Subscribers sampling late in the frame share a single wait
+  if (delay > 0.f) {
+    usleep(delay * g_ticker.clock.frame_time);
+    for (int i = 0; i < g_ticker.count; i++) {
+      struct animation* animation = g_ticker.subscribers[i];
+      if (animation->delay > 0.f && animation_due(animation, frame)) {
+        animation->proc(animation, time);
+      }
+    }
+  }
+  pthread_mutex_unlock(&g_ticker.mutex);
+}
 
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wdeprecated-declarations"
-void animation_start(struct animation* animation, void* proc, void* context) {
-  assert(animation->link == NULL);
-  assert(animation->context == NULL);
-  CVDisplayLinkCreateWithActiveCGDisplays(&animation->link);
-  CVTime refresh_period
-            = CVDisplayLinkGetNominalOutputVideoRefreshPeriod(animation->link);
-  animation->frame_time = 1e6 * (double)refresh_period.timeValue
-                        / (double)refresh_period.timeScale;
+void animation_start(struct animation* animation, animation_proc* proc, void* context) {
+  assert(!animation->subscribed);
+  pthread_mutex_lock(&g_ticker.clock_mutex);
+  if (!g_ticker.clock.running) {
+    const struct clock_backend* backend = g_ticker.clock.backend;
+    double rate = g_ticker.clock.rate;
+    clock_init(&g_ticker.clock, backend, animation_clock_proc, NULL);
+    g_ticker.clock.rate = rate;
+    clock_start(&g_ticker.clock);
+  }
 
   animation->context = context;
-  CVDisplayLinkSetOutputCallback(animation->link, proc, animation);
-  CVDisplayLinkStart(animation->link);
+  animation->proc = proc;
+  animation->frame_time = g_ticker.clock.frame_time;
+  animation->frequency = g_ticker.clock.frequency;
+  if (animation->divider < 1) animation->divider = 1;
+
+  pthread_mutex_lock(&g_ticker.mutex);
+  if (g_ticker.count == g_ticker.capacity) {
+    g_ticker.capacity = g_ticker.capacity ? 2 * g_ticker.capacity : 16;
+    g_ticker.subscribers = realloc(g_ticker.subscribers,
+                                   sizeof(struct animation*)
+                                   * g_ticker.capacity      );
+  }
+  animation->slot = g_ticker.next_slot++;
+  g_ticker.subscribers[g_ticker.count++] = animation;
+  animation->subscribed = true;
+  pthread_mutex_unlock(&g_ticker.mutex);
+  pthread_mutex_unlock(&g_ticker.clock_mutex);
 }
 
 void animation_stop(struct animation* animation) {
-  if (animation->link) {
-    CVDisplayLinkStop(animation->link);
-    CVDisplayLinkRelease(animation->link);
-    animation->link = NULL;
+  pthread_mutex_lock(&g_ticker.clock_mutex);
+  if (animation->subscribed) {
+    pthread_mutex_lock(&g_ticker.mutex);
+    for (int i = 0; i < g_ticker.count; i++) {
+      if (g_ticker.subscribers[i] == animation) {
+        g_ticker.subscribers[i] = g_ticker.subscribers[--g_ticker.count];
+        break;
+      }
+    }
+    animation->subscribed = false;
+    bool idle = g_ticker.count == 0;
+    pthread_mutex_unlock(&g_ticker.mutex);
+
+    // The clock waits for a frame in flight, which needs the mutex
+    if (idle) clock_stop(&g_ticker.clock);
   }
   // The context is managed by the caller of animation_start.
   // animation_start does not allocate it, so animation_stop should not free it.
-  // if (animation->context) free(animation->context); // Original line - REMOVED
   animation->context = NULL;
+  pthread_mutex_unlock(&g_ticker.clock_mutex);
+}
+
+int animation_ticker_subscribers() {
+  pthread_mutex_lock(&g_ticker.mutex);
+  int count = g_ticker.count;
+  pthread_mutex_unlock(&g_ticker.mutex);
+  return count;
+}
+
+uint64_t animation_ticker_frames() {
+  pthread_mutex_lock(&g_ticker.mutex);
+  uint64_t frames = g_ticker.frame;
+  pthread_mutex_unlock(&g_ticker.mutex);
+  return frames;
 }
-#pragma clang diagnostic pop
@@ -1,13 +1,48 @@
 #pragma once
-#include <CoreVideo/CoreVideo.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <pthread.h>
+#include "clock.h"
+
+// All animations share one ticker: a single clock runs every subscribed
+// animation once per frame on its thread, instead of one display link with
+// a thread of its own per animation. The clock only runs while there are
+// subscribers.
+
+struct animation;
+typedef void animation_proc(struct animation* animation, uint64_t time);
 
 struct animation {
   void* context;
-  double frame_time;
-  CVDisplayLinkRef link;
+  double frame_time;        // Microseconds per frame of the ticker clock
+  double frequency;         // Units per second of the time passed to proc
+
+  animation_proc* proc;
+  uint32_t divider;         // Runs every divider frames, spread by slot
+  uint32_t slot;
+  float delay;              // Fraction of a frame to wait before running
+  bool subscribed;
 };
 
 void animation_init(struct animation* animation);
-void animation_start(struct animation* animation, void* proc, void* context);
+
+// Subscribes the animation to the ticker, proc runs on the ticker thread.
+// The divider and delay are kept from before the start.
+void animation_start(struct animation* animation, animation_proc* proc, void* context);
+
+// Unsubscribes the animation. Once this returns its proc is not running and
+// will not run again, so the context may be freed.
 void animation_stop(struct animation* animation);
+
+void animation_set_divider(struct animation* animation, uint32_t divider);
+
+// Selects the clock backend (NULL for the default) and its rate (0 for the
+// default), effective the next time the clock starts
+void animation_ticker_set_clock(const struct clock_backend* backend, double rate);
+
+// Runs the subscribers due on this frame, called by the clock
+void animation_ticker_tick(uint64_t time);
+
+// Number of subscribers and of frames ticked since the process started
+int animation_ticker_subscribers();
+uint64_t animation_ticker_frames();
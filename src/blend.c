@@ -0,0 +1,275 @@
+#include "blend.h"
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLEND_X86
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BLEND_NEON
+#endif
+
+// Every channel is computed as
+//   (2 * (c_from * (max - step) + c_to * step) + max) / (2 * max)
+// which is exactly the rounding of interpolate_channel. The vector paths
+// replace the division by a multiplication with a 32 bit reciprocal, which is
+// exact as long as the dividend stays below 2^32 / (2 * max). With 8 bit
+// channels this holds for up to BLEND_MAX_VECTOR_STEPS steps, the 16 bit
+// weights of the SSE2/AVX2 multiply-add impose the same bound.
+#define BLEND_MAX_VECTOR_STEPS 2048
+
+static inline uint32_t blend_alpha(uint32_t from) {
+  uint32_t alpha = from >> 24;
+  return (alpha ? alpha : 0xff) << 24;
+}
+
+static inline uint32_t blend_scalar(uint32_t from, uint32_t to, uint32_t w_from, uint32_t w_to, uint32_t max) {
+  uint32_t result = blend_alpha(from);
+  for (int shift = 0; shift <= 16; shift += 8) {
+    uint64_t c_from = (from >> shift) & 0xff;
+    uint64_t c_to = (to >> shift) & 0xff;
+    uint64_t n = 2 * (c_from * w_from + c_to * w_to) + max;
+    result |= (uint32_t)(n / (2 * (uint64_t)max)) << shift;
+  }
+  return result;
+}
+
+// Normalises the step the same way interpolate_channel does: anything at or
+// below zero yields the source, anything at or above max the target.
+static inline void blend_weights(int step, int max_steps, uint32_t* w_from, uint32_t* w_to, uint32_t* max) {
+  if (max_steps <= 0) {
+    *max = 1;
+    *w_to = step > 0;
+  } else {
+    *max = max_steps;
+    *w_to = step <= 0 ? 0 : (step >= max_steps ? max_steps : step);
+  }
+  *w_from = *max - *w_to;
+}
+
+static inline uint32_t blend_reciprocal(uint32_t max) {
+  return (uint32_t)((1ull << 32) / (2 * max) + 1);
+}
+
+#ifdef BLEND_X86
+static inline __m128i blend_channel_sse2(__m128i from, __m128i to, __m128i weights, __m128i half, __m128i reciprocal, int shift) {
+  __m128i count = _mm_cvtsi32_si128(shift);
+  __m128i byte = _mm_set1_epi32(0xff);
+  __m128i c_from = _mm_and_si128(_mm_srl_epi32(from, count), byte);
+  __m128i c_to = _mm_and_si128(_mm_srl_epi32(to, count), byte);
+
+  // (c_from | c_to << 16) * (w_from | w_to << 16) pairwise in 16 bit
+  __m128i pairs = _mm_or_si128(c_from, _mm_slli_epi32(c_to, 16));
+  __m128i n = _mm_add_epi32(_mm_slli_epi32(_mm_madd_epi16(pairs, weights), 1),
+                            half                                             );
+
+  __m128i even = _mm_mul_epu32(n, reciprocal);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(n, 32), reciprocal);
+  __m128i q = _mm_or_si128(_mm_srli_epi64(even, 32),
+                           _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0)));
+  return _mm_sll_epi32(q, count);
+}
+
+static inline __m128i blend4_sse2(__m128i from, __m128i to, __m128i weights, __m128i half, __m128i reciprocal) {
+  __m128i alpha = _mm_srli_epi32(from, 24);
+  alpha = _mm_or_si128(alpha, _mm_and_si128(_mm_cmpeq_epi32(alpha,
+                                                            _mm_setzero_si128()),
+                                            _mm_set1_epi32(0xff)            ));
+  __m128i result = _mm_slli_epi32(alpha, 24);
+  result = _mm_or_si128(result, blend_channel_sse2(from, to, weights, half, reciprocal, 0));
+  result = _mm_or_si128(result, blend_channel_sse2(from, to, weights, half, reciprocal, 8));
+  result = _mm_or_si128(result, blend_channel_sse2(from, to, weights, half, reciprocal, 16));
+  return result;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blend_channel_avx2(__m256i from, __m256i to, __m256i weights, __m256i half, __m256i reciprocal, int shift) {
+  __m128i count = _mm_cvtsi32_si128(shift);
+  __m256i byte = _mm256_set1_epi32(0xff);
+  __m256i c_from = _mm256_and_si256(_mm256_srl_epi32(from, count), byte);
+  __m256i c_to = _mm256_and_si256(_mm256_srl_epi32(to, count), byte);
+
+  __m256i pairs = _mm256_or_si256(c_from, _mm256_slli_epi32(c_to, 16));
+  __m256i n = _mm256_add_epi32(_mm256_slli_epi32(_mm256_madd_epi16(pairs,
+                                                                   weights),
+                                                 1                        ),
+                               half                                        );
+
+  __m256i even = _mm256_mul_epu32(n, reciprocal);
+  __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(n, 32), reciprocal);
+  __m256i q = _mm256_or_si256(_mm256_srli_epi64(even, 32),
+                              _mm256_and_si256(odd,
+                                               _mm256_set_epi32(-1, 0, -1, 0,
+                                                                -1, 0, -1, 0)));
+  return _mm256_sll_epi32(q, count);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blend8_avx2(__m256i from, __m256i to, __m256i weights, __m256i half, __m256i reciprocal) {
+  __m256i alpha = _mm256_srli_epi32(from, 24);
+  alpha = _mm256_or_si256(alpha,
+                          _mm256_and_si256(_mm256_cmpeq_epi32(alpha,
+                                                   _mm256_setzero_si256()),
+                                           _mm256_set1_epi32(0xff)        ));
+  __m256i result = _mm256_slli_epi32(alpha, 24);
+  result = _mm256_or_si256(result, blend_channel_avx2(from, to, weights, half, reciprocal, 0));
+  result = _mm256_or_si256(result, blend_channel_avx2(from, to, weights, half, reciprocal, 8));
+  result = _mm256_or_si256(result, blend_channel_avx2(from, to, weights, half, reciprocal, 16));
+  return result;
+}
+
+static bool blend_has_avx2() {
+  static int has_avx2 = -1;
+  if (has_avx2 < 0) has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+  return has_avx2;
+}
+
+__attribute__((target("avx2")))
+static int blend_colors_avx2(const uint32_t* from, const uint32_t* to, uint32_t* out, int count, uint32_t weights, uint32_t max) {
+  __m256i w = _mm256_set1_epi32(weights);
+  __m256i half = _mm256_set1_epi32(max);
+  __m256i reciprocal = _mm256_set1_epi32(blend_reciprocal(max));
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i f = _mm256_loadu_si256((const __m256i*)(from + i));
+    __m256i t = _mm256_loadu_si256((const __m256i*)(to + i));
+    _mm256_storeu_si256((__m256i*)(out + i),
+                        blend8_avx2(f, t, w, half, reciprocal));
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static int blend_color_steps_avx2(uint32_t from, uint32_t to, uint32_t* out, int count, uint32_t max) {
+  // Lane j blends with the weights (max - j) | j << 16, moving one step
+  // between lanes adds 0xffff to the packed weights.
+  __m256i f = _mm256_set1_epi32(from);
+  __m256i t = _mm256_set1_epi32(to);
+  __m256i half = _mm256_set1_epi32(max);
+  __m256i reciprocal = _mm256_set1_epi32(blend_reciprocal(max));
+  __m256i w = _mm256_add_epi32(_mm256_set1_epi32(max),
+                               _mm256_mullo_epi32(_mm256_set_epi32(7, 6, 5, 4,
+                                                                   3, 2, 1, 0),
+                                                  _mm256_set1_epi32(0xffff)));
+  __m256i advance = _mm256_set1_epi32(8 * 0xffff);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_si256((__m256i*)(out + i),
+                        blend8_avx2(f, t, w, half, reciprocal));
+    w = _mm256_add_epi32(w, advance);
+  }
+  return i;
+}
+#endif
+
+#ifdef BLEND_NEON
+static inline uint32x4_t blend_channel_neon(uint32x4_t from, uint32x4_t to, uint32x4_t w_from, uint32x4_t w_to, uint32x4_t half, uint32x2_t reciprocal, int shift) {
+  uint32x4_t byte = vdupq_n_u32(0xff);
+  uint32x4_t c_from = vandq_u32(vshlq_u32(from, vdupq_n_s32(-shift)), byte);
+  uint32x4_t c_to = vandq_u32(vshlq_u32(to, vdupq_n_s32(-shift)), byte);
+
+  uint32x4_t n = vmlaq_u32(vmulq_u32(c_from, w_from), c_to, w_to);
+  n = vaddq_u32(vshlq_n_u32(n, 1), half);
+
+  uint64x2_t low = vmull_u32(vget_low_u32(n), reciprocal);
+  uint64x2_t high = vmull_u32(vget_high_u32(n), reciprocal);
+  uint32x4_t q = vcombine_u32(vshrn_n_u64(low, 32), vshrn_n_u64(high, 32));
+  return vshlq_u32(q, vdupq_n_s32(shift));
+}
+
+static inline uint32x4_t blend4_neon(uint32x4_t from, uint32x4_t to, uint32x4_t w_from, uint32x4_t w_to, uint32x4_t half, uint32x2_t reciprocal) {
+  uint32x4_t alpha = vshrq_n_u32(from, 24);
+  alpha = vorrq_u32(alpha, vandq_u32(vceqq_u32(alpha, vdupq_n_u32(0)),
+                                     vdupq_n_u32(0xff)               ));
+  uint32x4_t result = vshlq_n_u32(alpha, 24);
+  result = vorrq_u32(result, blend_channel_neon(from, to, w_from, w_to, half, reciprocal, 0));
+  result = vorrq_u32(result, blend_channel_neon(from, to, w_from, w_to, half, reciprocal, 8));
+  result = vorrq_u32(result, blend_channel_neon(from, to, w_from, w_to, half, reciprocal, 16));
+  return result;
+}
+#endif
+
+void blend_colors(const uint32_t* from, const uint32_t* to, uint32_t* out, int count, int step, int max_steps) {
+  uint32_t w_from, w_to, max;
+  blend_weights(step, max_steps, &w_from, &w_to, &max);
+
+  int i = 0;
+  if (max <= BLEND_MAX_VECTOR_STEPS) {
+#ifdef BLEND_X86
+    uint32_t weights = w_from | (w_to << 16);
+    if (blend_has_avx2()) {
+      i = blend_colors_avx2(from, to, out, count, weights, max);
+    }
+
+    __m128i w = _mm_set1_epi32(weights);
+    __m128i half = _mm_set1_epi32(max);
+    __m128i reciprocal = _mm_set1_epi32(blend_reciprocal(max));
+    for (; i + 4 <= count; i += 4) {
+      __m128i f = _mm_loadu_si128((const __m128i*)(from + i));
+      __m128i t = _mm_loadu_si128((const __m128i*)(to + i));
+      _mm_storeu_si128((__m128i*)(out + i),
+                       blend4_sse2(f, t, w, half, reciprocal));
+    }
+#elif defined(BLEND_NEON)
+    uint32x4_t wf = vdupq_n_u32(w_from);
+    uint32x4_t wt = vdupq_n_u32(w_to);
+    uint32x4_t half = vdupq_n_u32(max);
+    uint32x2_t reciprocal = vdup_n_u32(blend_reciprocal(max));
+    for (; i + 4 <= count; i += 4) {
+      uint32x4_t f = vld1q_u32(from + i);
+      uint32x4_t t = vld1q_u32(to + i);
+      vst1q_u32(out + i, blend4_neon(f, t, wf, wt, half, reciprocal));
+    }
+#endif
+  }
+
+  for (; i < count; i++) {
+    out[i] = blend_scalar(from[i], to[i], w_from, w_to, max);
+  }
+}
+
+void blend_color_steps(uint32_t from, uint32_t to, uint32_t* out, int max_steps) {
+  if (max_steps <= 0) {
+    out[0] = blend_scalar(from, to, 1, 0, 1);
+    return;
+  }
+
+  uint32_t max = max_steps;
+  int count = max_steps + 1;
+  int i = 0;
+  if (max <= BLEND_MAX_VECTOR_STEPS) {
+#ifdef BLEND_X86
+    if (blend_has_avx2()) i = blend_color_steps_avx2(from, to, out, count, max);
+
+    __m128i f = _mm_set1_epi32(from);
+    __m128i t = _mm_set1_epi32(to);
+    __m128i half = _mm_set1_epi32(max);
+    __m128i reciprocal = _mm_set1_epi32(blend_reciprocal(max));
+    __m128i w = _mm_add_epi32(_mm_set1_epi32((max - i) | (i << 16)),
+                              _mm_set_epi32(3 * 0xffff, 2 * 0xffff, 0xffff, 0));
+    __m128i advance = _mm_set1_epi32(4 * 0xffff);
+    for (; i + 4 <= count; i += 4) {
+      _mm_storeu_si128((__m128i*)(out + i),
+                       blend4_sse2(f, t, w, half, reciprocal));
+      w = _mm_add_epi32(w, advance);
+    }
+#elif defined(BLEND_NEON)
+    uint32x4_t f = vdupq_n_u32(from);
+    uint32x4_t t = vdupq_n_u32(to);
+    uint32x4_t half = vdupq_n_u32(max);
+    uint32x2_t reciprocal = vdup_n_u32(blend_reciprocal(max));
+    uint32_t lanes[4] = { 0, 1, 2, 3 };
+    uint32x4_t wt = vld1q_u32(lanes);
+    uint32x4_t advance = vdupq_n_u32(4);
+    for (; i + 4 <= count; i += 4) {
+      uint32x4_t wf = vsubq_u32(half, wt);
+      vst1q_u32(out + i, blend4_neon(f, t, wf, wt, half, reciprocal));
+      wt = vaddq_u32(wt, advance);
+    }
+#endif
+  }
+
+  for (; i < count; i++) {
+    out[i] = blend_scalar(from, to, max - i, i, max);
+  }
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <stdint.h>
+
+// Batch interpolation of packed 0xAARRGGBB colors in fixed point. The results
+// match interpolate_color_value bit for bit: the channels are rounded half up
+// and the alpha is taken from the source color (0xFF if it is transparent).
+// Vectorised with AVX2/SSE2 on x86 and NEON on ARM, with a scalar fallback.
+
+// Interpolates count color pairs at the same step
+void blend_colors(const uint32_t* from, const uint32_t* to, uint32_t* out, int count, int step, int max_steps);
+
+// Interpolates a single color pair at every step, filling out[0...max_steps]
+void blend_color_steps(uint32_t from, uint32_t to, uint32_t* out, int max_steps);
@@ -1,10 +1,13 @@
 #include "border.h"
 #include "hashtable.h"
 #include "windows.h"
+#include "gradient.h"
 #include <pthread.h>
 #include <time.h>
 
 extern struct settings g_settings;
+extern struct windows g_windows;
+extern struct gradient_cache g_gradient_cache;
 
 struct settings* border_get_settings(struct border* border) {
   assert(pthread_main_np() != 0);
@@ -93,32 +96,49 @@ static bool border_calculate_bounds(struct border* border, CGRect* frame, struct
   return true;
 }
 
-static void border_draw(struct border* border, CGRect frame, struct settings* settings) {
-  CGContextSaveGState(border->context);
-  border->needs_redraw = false;
-  struct color_style color_style = border->focused
-                                   ? settings->active_window
-                                   : settings->inactive_window;
+static atomic_uint_fast64_t g_plan_rebuilds;
+static atomic_uint_fast64_t g_plan_reuses;
 
-  CGGradientRef gradient = NULL;
-  CGPoint gradient_dir[2];
-  if (color_style.stype == COLOR_STYLE_SOLID
-     || color_style.stype == COLOR_STYLE_GLOW) {
-    bool glow = color_style.stype == COLOR_STYLE_GLOW;
-    drawing_set_stroke_and_fill(border->context, color_style.color, glow);
-  } else if (color_style.stype == COLOR_STYLE_GRADIENT) {
-    CGAffineTransform trans = CGAffineTransformMakeScale(frame.size.width,
-                                                         frame.size.height);
-    gradient = drawing_create_gradient(&color_style.gradient,
-                                       trans,
-                                       gradient_dir          );
-  }
+static void border_plan_release(struct border_plan* plan) {
+  if (plan->clip_path) CFRelease(plan->clip_path);
+  if (plan->inner_path) CFRelease(plan->inner_path);
+  if (plan->under_path) CFRelease(plan->under_path);
+  if (plan->shape_path) CFRelease(plan->shape_path);
+  if (plan->gradient_path) CFRelease(plan->gradient_path);
+  memset(plan, 0, sizeof(struct border_plan));
+}
 
-  CGContextSetLineWidth(border->context, settings->border_width);
-  CGContextClearRect(border->context, frame);
+static bool border_plan_key_equal(struct border_plan_key* a, struct border_plan_key* b) {
+  return CGSizeEqualToSize(a->size, b->size)
+         && CGRectEqualToRect(a->drawing_bounds, b->drawing_bounds)
+         && a->radius == b->radius
+         && a->inner_radius == b->inner_radius
+         && a->border_width == b->border_width
+         && a->border_style == b->border_style
+         && a->border_order == b->border_order;
+}
+
+// Rebuilds the paths of the plan if the geometry or the style changed
+static void border_plan_update(struct border* border, CGRect frame, struct settings* settings) {
+  struct border_plan_key key = { .size = frame.size,
+                                 .drawing_bounds = border->drawing_bounds,
+                                 .radius = border->radius,
+                                 .inner_radius = border->inner_radius,
+                                 .border_width = settings->border_width,
+                                 .border_style = settings->border_style,
+                                 .border_order = settings->border_order };
+
+  struct border_plan* plan = &border->plan;
+  if (plan->valid && border_plan_key_equal(&plan->key, &key)) {
+    atomic_fetch_add_explicit(&g_plan_reuses, 1, memory_order_relaxed);
+    return;
+  }
+  atomic_fetch_add_explicit(&g_plan_rebuilds, 1, memory_order_relaxed);
+  border_plan_release(plan);
+  plan->key = key;
 
   CGRect path_rect = border->drawing_bounds;
-  CGMutablePathRef inner_clip_path = CGPathCreateMutable();
+  CGMutablePathRef inner_path = CGPathCreateMutable();
   if (settings->border_style == BORDER_STYLE_SQUARE
       && settings->border_order == BORDER_ORDER_ABOVE
       && settings->border_width >= BORDER_TSMW) {
@@ -128,55 +148,84 @@ static void border_draw(struct border* border, CGRect frame, struct settings* se
                             BORDER_TSMN,
                             BORDER_TSMN            );
 
-    CGPathAddRect(inner_clip_path, NULL, path_rect);
+    CGPathAddRect(inner_path, NULL, path_rect);
   } else {
-    CGPathAddRoundedRect(inner_clip_path,
+    CGPathAddRoundedRect(inner_path,
                          NULL,
                          CGRectInset(path_rect, 1.0, 1.0),
                          border->inner_radius,
                          border->inner_radius             );
   }
-  drawing_clip_between_rect_and_path(border->context, frame, inner_clip_path);
+  plan->inner_path = inner_path;
+  plan->clip_path = drawing_create_path_between_rect_and_path(frame,
+                                                              inner_path);
 
   if (settings->border_style == BORDER_STYLE_SQUARE) {
-    if (color_style.stype == COLOR_STYLE_SOLID
-       || color_style.stype == COLOR_STYLE_GLOW) {
-      drawing_draw_square_with_inset(border->context,
-                                     path_rect,
-                                     -settings->border_width / 2.f);
-    }
-    else if (color_style.stype == COLOR_STYLE_GRADIENT) {
-      drawing_draw_square_gradient_with_inset(border->context,
-                                              gradient,
-                                              gradient_dir,
-                                              path_rect,
-                                              -settings->border_width / 2.f);
-    }
+    plan->shape_path = drawing_create_rect_with_inset(path_rect,
+                                                      -settings->border_width
+                                                      / 2.f                  );
+    plan->gradient_path = CFRetain(plan->shape_path);
+    plan->fill_shape = true;
   } else {
     float corner_radius = settings->border_style == BORDER_STYLE_ROUND_UNIFORM ? 9.0 : border->radius;
 
+    plan->shape_path = drawing_create_rounded_rect(path_rect, corner_radius);
+    plan->gradient_path = drawing_create_stroked_path(plan->shape_path,
+                                                      settings->border_width);
     if (settings->border_style == BORDER_STYLE_ROUND_UNIFORM) {
-      drawing_draw_rounded_rect_with_inset(border->context,
-                                           path_rect,
-                                           corner_radius,
-                                           true            );
+      plan->under_path = CFRetain(plan->shape_path);
     }
+    plan->fill_shape = false;
+  }
+  plan->valid = true;
+}
 
-    if (color_style.stype == COLOR_STYLE_SOLID
-       || color_style.stype == COLOR_STYLE_GLOW) {
-      drawing_draw_rounded_rect_with_inset(border->context,
-                                           path_rect,
-                                           corner_radius,
-                                           false           );
-    } else if (color_style.stype == COLOR_STYLE_GRADIENT) {
-      drawing_draw_rounded_gradient_with_inset(border->context,
-                                               gradient,
-                                               gradient_dir,
-                                               path_rect,
-                                               corner_radius  );
-    }
+void border_plan_stats(uint64_t* rebuilds, uint64_t* reuses) {
+  *rebuilds = atomic_load_explicit(&g_plan_rebuilds, memory_order_relaxed);
+  *reuses = atomic_load_explicit(&g_plan_reuses, memory_order_relaxed);
+}
+
+static void border_draw(struct border* border, CGRect frame, struct settings* settings) {
+  CGContextSaveGState(border->context);
+  border->needs_redraw = false;
+  border_plan_update(border, frame, settings);
+  struct border_plan* plan = &border->plan;
+  struct color_style color_style = border->focused
+                                   ? settings->active_window
+                                   : settings->inactive_window;
+
+  CGGradientRef gradient = NULL;
+  CGPoint gradient_dir[2];
+  if (color_style.stype == COLOR_STYLE_SOLID
+     || color_style.stype == COLOR_STYLE_GLOW) {
+    bool glow = color_style.stype == COLOR_STYLE_GLOW;
+    drawing_set_stroke_and_fill(border->context, color_style.color, glow);
+  } else if (color_style.stype == COLOR_STYLE_GRADIENT) {
+    // Held until the draw is done, an eviction meanwhile does not free it
+    gradient = gradient_cache_get(&g_gradient_cache,
+                                  color_style.gradient.color1,
+                                  color_style.gradient.color2,
+                                  GRADIENT_CACHE_SRGB         );
+    drawing_gradient_direction(&color_style.gradient,
+                               frame.size,
+                               gradient_dir          );
+  }
+
+  CGContextSetLineWidth(border->context, settings->border_width);
+  CGContextClearRect(border->context, frame);
+  drawing_clip_even_odd(border->context, plan->clip_path);
+
+  if (plan->under_path) drawing_draw_path(border->context, plan->under_path, true);
+
+  if (color_style.stype == COLOR_STYLE_SOLID
+     || color_style.stype == COLOR_STYLE_GLOW) {
+    drawing_draw_path(border->context, plan->shape_path, plan->fill_shape);
+  } else if (gradient) {
+    drawing_draw_gradient_in_path(border->context,
+                                  gradient,
+                                  gradient_dir,
+                                  plan->gradient_path);
   }
-  CGGradientRelease(gradient);
 
   if (settings->show_background && settings->border_order != 1) {
     CGContextRestoreGState(border->context);
@@ -185,11 +234,11 @@ static void border_draw(struct border* border, CGRect frame, struct settings* se
     if (color_style.stype == COLOR_STYLE_SOLID
        || color_style.stype == COLOR_STYLE_GLOW) {
       drawing_draw_filled_path(border->context,
-                               inner_clip_path,
+                               plan->inner_path,
                                color_style.color);
     }
   }
-  CFRelease(inner_clip_path);
+  if (gradient) CGGradientRelease(gradient);
   CGContextFlush(border->context);
   CGContextRestoreGState(border->context);
   SLSFlushWindowContentRegion(border->cid, border->wid, NULL);
@@ -301,16 +350,44 @@ void border_update_internal(struct border* border, struct settings* settings) {
   if (disabled_update) SLSReenableUpdate(cid);
 }
 
+// Settings are copied on the main thread, the only one allowed to read them
+struct border_update_payload {
+  struct border* border;
+  struct settings settings;
+  struct gradient_pacing* pacing;   // Receives the draw time if set
+};
+
 static void* border_update_async_proc(void* context) {
-  struct {
-    struct border* border;
-    struct settings settings;
-  }* payload = context;
-
-  pthread_mutex_lock(&payload->border->mutex);
-  border_update_internal(payload->border, &payload->settings);
-  pthread_mutex_unlock(&payload->border->mutex);
+  struct border_update_payload* payload = context;
+
+  struct border* border = payload->border;
+  pthread_mutex_lock(&border->mutex);
+
+  // The space and the sticky tag are looked up here instead of on the main
+  // thread, which only re-indexes the border if either of them changed
+  bool sticky = border->sticky;
+  uint64_t sid = border->sid;
+  uint64_t space = window_space_id(border->cid, border->target_wid);
+  if (space) border->sid = space;
+
+  uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+  border_update_internal(border, &payload->settings);
+  if (payload->pacing) {
+    gradient_pacing_drawn(payload->pacing,
+                          start,
+                          clock_gettime_nsec_np(CLOCK_UPTIME_RAW));
+  }
+  bool moved = !border->is_proxy
+               && (border->sticky != sticky || border->sid != sid);
+  uint64_t handle = border->handle;
+  pthread_mutex_unlock(&border->mutex);
   free(payload);
+
+  if (moved) {
+    dispatch_async(dispatch_get_main_queue(), ^{
+      windows_window_reindex(&g_windows, handle);
+    });
+  }
   return NULL;
 }
 
@@ -321,6 +398,7 @@ void border_init(struct border* border, int cid) {
   pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE);
   pthread_mutex_init(&border->mutex, &mattr);
   animation_init(&border->animation);
+  border->space.owner = border;
   if (cid) border->cid = cid;
   else border->cid = SLSMainConnectionID();
 }
@@ -338,6 +416,8 @@ void border_destroy(struct border* border) {
   dispatch_async(dispatch_get_main_queue(), ^{
     pthread_mutex_lock(&border->mutex);
     border_destroy_window(border);
+    border_plan_release(&border->plan);
+    gradient_palette_release(border->setting_override.animated_gradient_palette);
     if (border->proxy) border_destroy(border->proxy);
     animation_stop(&border->animation);
     if (!border->is_proxy && border->cid != SLSMainConnectionID())
@@ -383,22 +463,27 @@ void border_move(struct border* border) {
   });
 }
 
-void border_update(struct border* border, bool try_async) {
+static void border_update_timed(struct border* border, bool try_async, struct gradient_pacing* pacing) {
   pthread_mutex_lock(&border->mutex);
   struct settings* settings = border_get_settings(border);
   if (!border->wid || !try_async) {
+    uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
     border_update_internal(border, settings);
+    if (pacing) {
+      gradient_pacing_drawn(pacing,
+                            start,
+                            clock_gettime_nsec_np(CLOCK_UPTIME_RAW));
+    }
     pthread_mutex_unlock(&border->mutex);
     return;
   }
 
-  struct payload {
-    struct border* border;
-    struct settings settings;
-  }* payload = malloc(sizeof(struct payload));
+  struct border_update_payload* payload
+                             = malloc(sizeof(struct border_update_payload));
 
   payload->border = border;
   payload->settings = *settings;
+  payload->pacing = pacing;
 
   pthread_t thread;
   pthread_create(&thread, NULL, border_update_async_proc, payload);
@@ -406,6 +491,15 @@ void border_update(struct border* border, bool try_async) {
   pthread_mutex_unlock(&border->mutex);
 }
 
+void border_update(struct border* border, bool try_async) {
+  border_update_timed(border, try_async, NULL);
+}
+
+void border_redraw_frame(struct border* border, struct gradient_pacing* pacing) {
+  border->needs_redraw = true;
+  border_update_timed(border, true, pacing);
+}
+
 void border_hide(struct border* border) {
   pthread_mutex_lock(&border->mutex);
   if (border->wid) {
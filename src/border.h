@@ -5,12 +5,9 @@
 #include "misc/drawing.h"
 #include "animation.h"
 #include "hashtable.h"
+#include "settings.h"
+#include "space_index.h"
 
-#define BORDER_ORDER_ABOVE 1
-#define BORDER_ORDER_BELOW -1
-#define BORDER_STYLE_ROUND  'r'
-#define BORDER_STYLE_ROUND_UNIFORM 'u'
-#define BORDER_STYLE_SQUARE 's'
 #define BORDER_PADDING 8.0
 #define BORDER_TSMN 3.27f
 
@@ -20,51 +17,35 @@
 #define BORDER_TSMW 8.f
 #endif
 
-struct color_style {
-  enum { COLOR_STYLE_GRADIENT, COLOR_STYLE_SOLID, COLOR_STYLE_GLOW } stype;
-  union {
-    uint32_t color;
-    struct gradient gradient;
-  };
+struct event_buffer {
+  bool disable_coalescing;
+  volatile bool is_coalescing;
+  int64_t last_coalesce_attempt;
 };
 
-struct settings {
-  bool enabled;
-  uint32_t apply_to;
-
-  struct color_style active_window;
-  struct color_style inactive_window;
-  struct color_style corner_mask;
-  struct color_style background;
-
+// The paths of a draw only depend on the geometry and the style of the
+// border, a border keeps them until one of these inputs changes and a redraw
+// with new colors reuses them.
+struct border_plan_key {
+  CGSize size;
+  CGRect drawing_bounds;
+  float radius;
+  float inner_radius;
   float border_width;
-  float blur_radius;
   char border_style;
-  bool hidpi;
-  bool show_background;
   int border_order;
-  bool ax_focus;
-
-  bool blacklist_enabled;
-  struct table blacklist;
-
-  bool whitelist_enabled;
-  struct table whitelist;
-
-  // --- Added for Gradient Animation ---
-  bool animated_gradient_enabled;
-  uint32_t* parsed_gradient_colors; // Array of parsed 0xAARRGGBB colors
-  int num_parsed_gradient_colors;
-  int animated_gradient_steps;
-  float animated_gradient_duration_sec;
-  // struct table animated_gradient_color_list; // Optional: if raw strings are needed for other purposes
-  // --- End Added for Gradient Animation ---
 };
 
-struct event_buffer {
-  bool disable_coalescing;
-  volatile bool is_coalescing;
-  int64_t last_coalesce_attempt;
+struct border_plan {
+  bool valid;
+  struct border_plan_key key;
+
+  CGPathRef clip_path;        // Even-odd area between the frame and window
+  CGPathRef inner_path;       // The window, filled by the background
+  CGPathRef under_path;       // Filled below the border (uniform style)
+  CGPathRef shape_path;       // Drawn with a solid color
+  CGPathRef gradient_path;    // Area covered by a gradient
+  bool fill_shape;            // The shape is filled instead of stroked
 };
 
 struct border {
@@ -75,8 +56,10 @@ struct border {
   bool needs_redraw;
   bool too_small;
   bool sticky;
+  bool hidden;
 
   uint64_t sid;
+  uint64_t handle;
   uint32_t wid;
   uint32_t target_wid;
 
@@ -97,13 +80,30 @@ struct border {
   volatile uint32_t external_proxy_wid;
 
   struct settings setting_override;
+  struct border_plan plan;
+
+  // Inactive gradient colors and angle last drawn and the next frame of the
+  // lower rate redraw schedule
+  uint64_t gradient_colors;
+  uint32_t gradient_angle;
+  uint64_t gradient_next_frame;
+
+  struct space_link space;
 };
 
 struct border* border_create();
 void border_destroy(struct border* border);
 
+// Number of draws which rebuilt their plan and which reused it
+void border_plan_stats(uint64_t* rebuilds, uint64_t* reuses);
+
 void border_move(struct border* border);
 void border_update(struct border* border, bool try_async);
+
+// Redraws the border for an animation frame. The time the redraw takes on
+// its update thread is recorded as a draw sample of the pacing.
+struct gradient_pacing;
+void border_redraw_frame(struct border* border, struct gradient_pacing* pacing);
 void border_hide(struct border* border);
 void border_unhide(struct border* border);
 
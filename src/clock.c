@@ -0,0 +1,214 @@
+#include "clock.h"
+#include <string.h>
+
+#ifdef __APPLE__
+#include <CoreVideo/CoreVideo.h>
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+static CVReturn clock_display_link_callback(CVDisplayLinkRef link, const CVTimeStamp* now, const CVTimeStamp* output_time, CVOptionFlags flags, CVOptionFlags* flags_out, void* context) {
+  struct clock* clock = context;
+  clock->proc(clock, output_time->hostTime);
+  return kCVReturnSuccess;
+}
+
+static bool clock_display_link_start(struct clock* clock) {
+  CVDisplayLinkRef link = NULL;
+  CVDisplayLinkCreateWithActiveCGDisplays(&link);
+  if (!link) return false;
+
+  CVTime refresh_period = CVDisplayLinkGetNominalOutputVideoRefreshPeriod(link);
+  clock->frame_time = 1e6 * (double)refresh_period.timeValue
+                      / (double)refresh_period.timeScale;
+  clock->frequency = CVGetHostClockFrequency();
+  clock->handle = link;
+  clock->running = true;
+
+  CVDisplayLinkSetOutputCallback(link, clock_display_link_callback, clock);
+  CVDisplayLinkStart(link);
+  return true;
+}
+
+static void clock_display_link_stop(struct clock* clock) {
+  CVDisplayLinkRef link = clock->handle;
+  if (link) {
+    CVDisplayLinkStop(link);
+    CVDisplayLinkRelease(link);
+  }
+  clock->handle = NULL;
+  clock->running = false;
+}
+#pragma clang diagnostic pop
+
+const struct clock_backend g_clock_display_link = {
+  .name = "display_link",
+  .start = clock_display_link_start,
+  .stop = clock_display_link_stop
+};
+#endif
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t clock_monotonic_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// The timer expires every frame, so stopping never waits for more than one.
+// Expirations missed while a frame ran are dropped, not replayed.
+static void* clock_timerfd_proc(void* context) {
+  struct clock* clock = context;
+  int fd = (int)(intptr_t)clock->handle;
+  while (clock->running) {
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+      continue;
+    }
+    if (!clock->running) break;
+    clock->proc(clock, clock_monotonic_ns());
+  }
+  return NULL;
+}
+
+static bool clock_timerfd_start(struct clock* clock) {
+  double rate = clock->rate > 0 ? clock->rate : CLOCK_DEFAULT_RATE;
+  int fd = timerfd_create(CLOCK_MONOTONIC, 0);
+  if (fd < 0) return false;
+
+  uint64_t period = (uint64_t)(1e9 / rate);
+  struct itimerspec spec = {
+    .it_interval = { period / 1000000000ull, period % 1000000000ull },
+    .it_value = { period / 1000000000ull, period % 1000000000ull }
+  };
+  if (timerfd_settime(fd, 0, &spec, NULL) < 0) {
+    close(fd);
+    return false;
+  }
+
+  clock->frame_time = 1e6 / rate;
+  clock->frequency = 1e9;
+  clock->handle = (void*)(intptr_t)fd;
+  clock->running = true;
+  if (pthread_create(&clock->thread, NULL, clock_timerfd_proc, clock) != 0) {
+    clock->running = false;
+    close(fd);
+    return false;
+  }
+  return true;
+}
+
+static void clock_timerfd_stop(struct clock* clock) {
+  if (!clock->running) return;
+  clock->running = false;
+  pthread_join(clock->thread, NULL);
+  close((int)(intptr_t)clock->handle);
+  clock->handle = NULL;
+}
+
+const struct clock_backend g_clock_timerfd = {
+  .name = "timerfd",
+  .start = clock_timerfd_start,
+  .stop = clock_timerfd_stop
+};
+#endif
+
+static struct {
+  struct clock* clock;
+  double jitter;
+  double drop;
+  uint32_t seed;
+  uint32_t random;
+  uint64_t vsync;
+} g_virtual;
+
+static inline uint32_t clock_virtual_random() {
+  uint32_t x = g_virtual.random;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  g_virtual.random = x;
+  return x;
+}
+
+static bool clock_virtual_start(struct clock* clock) {
+  double rate = clock->rate > 0 ? clock->rate : CLOCK_DEFAULT_RATE;
+  clock->frame_time = 1e6 / rate;
+  clock->frequency = 1e9;
+  clock->running = true;
+  g_virtual.clock = clock;
+  g_virtual.random = g_virtual.seed ? g_virtual.seed : 0x9e3779b9;
+  g_virtual.vsync = 0;
+  return true;
+}
+
+static void clock_virtual_stop(struct clock* clock) {
+  clock->running = false;
+  if (g_virtual.clock == clock) g_virtual.clock = NULL;
+}
+
+const struct clock_backend g_clock_virtual = {
+  .name = "virtual",
+  .start = clock_virtual_start,
+  .stop = clock_virtual_stop
+};
+
+void clock_virtual_configure(double jitter, double drop, uint32_t seed) {
+  g_virtual.jitter = jitter;
+  g_virtual.drop = drop;
+  g_virtual.seed = seed;
+}
+
+uint64_t clock_virtual_run(uint64_t vsyncs) {
+  struct clock* clock = g_virtual.clock;
+  if (!clock) return 0;
+
+  // The first vsync is one frame after the start, like a real display
+  double period = clock->frame_time * 1000.0;
+  uint64_t frames = 0;
+  for (uint64_t i = 0; i < vsyncs && clock->running; i++) {
+    uint64_t vsync = ++g_virtual.vsync;
+    if (g_virtual.drop > 0
+        && clock_virtual_random() < g_virtual.drop * UINT32_MAX) {
+      continue;
+    }
+
+    double offset = 0;
+    if (g_virtual.jitter > 0) {
+      double unit = (double)clock_virtual_random() / UINT32_MAX;
+      offset = (2.0 * unit - 1.0) * g_virtual.jitter * period;
+    }
+    clock->proc(clock, (uint64_t)(vsync * period + offset));
+    frames++;
+  }
+  return frames;
+}
+
+const struct clock_backend* clock_default_backend() {
+#ifdef __APPLE__
+  return &g_clock_display_link;
+#elif defined(__linux__)
+  return &g_clock_timerfd;
+#else
+  return NULL;
+#endif
+}
+
+void clock_init(struct clock* clock, const struct clock_backend* backend, clock_proc* proc, void* context) {
+  memset(clock, 0, sizeof(struct clock));
+  clock->backend = backend ? backend : clock_default_backend();
+  clock->proc = proc;
+  clock->context = context;
+}
+
+bool clock_start(struct clock* clock) {
+  if (clock->running || !clock->backend) return clock->running;
+  return clock->backend->start(clock);
+}
+
+void clock_stop(struct clock* clock) {
+  if (clock->running && clock->backend) clock->backend->stop(clock);
+}
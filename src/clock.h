@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// Sources of frame ticks for the animation ticker. A backend calls the proc
+// of its clock once per frame, on a thread of its own, with the time of the
+// frame in units of the clock frequency.
+
+struct clock;
+typedef void clock_proc(struct clock* clock, uint64_t time);
+
+struct clock_backend {
+  const char* name;
+  bool (*start)(struct clock* clock);
+  void (*stop)(struct clock* clock);
+};
+
+struct clock {
+  const struct clock_backend* backend;
+  clock_proc* proc;
+  void* context;
+
+  double frame_time;        // Microseconds per frame, set by start
+  double frequency;         // Time units per second, set by start
+  double rate;              // Requested frames per second, 0 for the default
+
+  // State of the backend
+  void* handle;
+  pthread_t thread;
+  volatile bool running;
+};
+
+#ifdef __APPLE__
+// Ticks with the vsync of the active displays
+extern const struct clock_backend g_clock_display_link;
+#endif
+
+#ifdef __linux__
+// Ticks from a periodic timerfd at the requested rate, for running headless
+extern const struct clock_backend g_clock_timerfd;
+#endif
+
+// Deterministic clock without a thread of its own: clock_virtual_run produces
+// the frames on the calling thread, in nanoseconds of virtual time. The
+// timestamps can be jittered and vsyncs dropped, reproducibly from a seed.
+extern const struct clock_backend g_clock_virtual;
+
+// jitter is the largest deviation of a timestamp from its vsync as a
+// fraction of a frame (below 0.5), drop the probability a vsync is missed
+void clock_virtual_configure(double jitter, double drop, uint32_t seed);
+
+// Advances the running virtual clock by the given number of vsyncs and
+// returns the number of frames delivered
+uint64_t clock_virtual_run(uint64_t vsyncs);
+
+// The display link where there is one, the timerfd otherwise
+const struct clock_backend* clock_default_backend();
+
+#define CLOCK_DEFAULT_RATE 60.0
+
+void clock_init(struct clock* clock, const struct clock_backend* backend, clock_proc* proc, void* context);
+bool clock_start(struct clock* clock);
+void clock_stop(struct clock* clock);
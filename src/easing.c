@@ -0,0 +1,59 @@
+#include "easing.h"
+#include <math.h>
+
+// Coordinate of a cubic bezier from (0, 0) over p1 and p2 to (1, 1) at t
+static inline double easing_bezier(double p1, double p2, double t) {
+  double u = 1.0 - t;
+  return 3.0 * u * u * t * p1 + 3.0 * u * t * t * p2 + t * t * t;
+}
+
+static inline double easing_bezier_slope(double p1, double p2, double t) {
+  double u = 1.0 - t;
+  return 3.0 * u * u * p1 + 6.0 * u * t * (p2 - p1) + 3.0 * t * t * (1.0 - p2);
+}
+
+// Solves x(t) = x for t with Newton's method, falling back to bisection where
+// the curve is too flat. x(t) is monotonic as x1 and x2 lie in [0, 1].
+static double easing_solve(double x1, double x2, double x) {
+  double t = x;
+  for (int i = 0; i < 8; i++) {
+    double error = easing_bezier(x1, x2, t) - x;
+    if (fabs(error) < 1e-9) return t;
+    double slope = easing_bezier_slope(x1, x2, t);
+    if (fabs(slope) < 1e-6) break;
+    t -= error / slope;
+  }
+
+  double low = 0.0, high = 1.0;
+  t = x;
+  for (int i = 0; i < 64; i++) {
+    double value = easing_bezier(x1, x2, t);
+    if (fabs(value - x) < 1e-9) break;
+    if (value < x) low = t;
+    else high = t;
+    t = (low + high) / 2.0;
+  }
+  return t;
+}
+
+void easing_build_table(struct easing* easing, uint32_t* table) {
+  double x1 = 0.42, y1 = 0.0, x2 = 0.58, y2 = 1.0;
+  if (easing->type == EASING_CUBIC_BEZIER) {
+    x1 = fmin(fmax(easing->x1, 0.0), 1.0);
+    x2 = fmin(fmax(easing->x2, 0.0), 1.0);
+    y1 = easing->y1;
+    y2 = easing->y2;
+  }
+
+  for (int i = 0; i <= EASING_STEPS; i++) {
+    double x = (double)i / EASING_STEPS;
+    double y = x;
+    if (easing->type != EASING_LINEAR) {
+      y = easing_bezier(y1, y2, easing_solve(x1, x2, x));
+    }
+    y = fmin(fmax(y, 0.0), 1.0);
+    table[i] = (uint32_t)(y * EASING_ONE + 0.5);
+  }
+  table[0] = 0;
+  table[EASING_STEPS] = EASING_ONE;
+}
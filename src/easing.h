@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+
+// Easing curves of the gradient transitions. A curve is evaluated once into
+// a fixed point table over the progress of a transition, a frame then costs a
+// lookup instead of solving the curve.
+
+#define EASING_LINEAR       0
+#define EASING_EASE_IN_OUT  1
+#define EASING_CUBIC_BEZIER 2
+
+// Table resolution and the fixed point value of a progress of 1
+#define EASING_STEPS 1024
+#define EASING_ONE   65536
+
+struct easing {
+  int type;                   // EASING_*
+  float x1, y1, x2, y2;       // Control points of EASING_CUBIC_BEZIER
+};
+
+// Fills table[0...EASING_STEPS] with the eased progress of each step. Curves
+// overshooting 0 or 1 are clipped, as a transition can not leave its colors.
+void easing_build_table(struct easing* easing, uint32_t* table);
+
+// Maps the linear progress in [0, 1) to the eased one, interpolating between
+// the two table entries around it
+static inline double easing_apply(uint32_t* table, double progress) {
+  double position = progress * EASING_STEPS;
+  int step = (int)position;
+  if (step >= EASING_STEPS) return (double)table[EASING_STEPS] / EASING_ONE;
+  double a = table[step];
+  double b = table[step + 1];
+  return (a + (b - a) * (position - step)) / EASING_ONE;
+}
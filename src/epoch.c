@@ -0,0 +1,72 @@
+#include "epoch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+void epoch_init(struct epoch* epoch) {
+  memset(epoch->limbo, 0, sizeof(epoch->limbo));
+  atomic_init(&epoch->current, 0);
+  atomic_init(&epoch->readers[0], 0);
+  atomic_init(&epoch->readers[1], 0);
+}
+
+static void epoch_limbo_release(struct epoch_limbo* limbo) {
+  for (int i = 0; i < limbo->count; ++i) {
+    limbo->items[i].free(limbo->items[i].ptr);
+  }
+  limbo->count = 0;
+}
+
+void epoch_free(struct epoch* epoch) {
+  for (int i = 0; i < 2; ++i) {
+    epoch_limbo_release(epoch->limbo + i);
+    if (epoch->limbo[i].items) free(epoch->limbo[i].items);
+    epoch->limbo[i].items = NULL;
+    epoch->limbo[i].capacity = 0;
+  }
+}
+
+uint64_t epoch_enter(struct epoch* epoch) {
+  while (true) {
+    uint64_t current = atomic_load(&epoch->current);
+    atomic_fetch_add(&epoch->readers[current & 1], 1);
+    // The writer might have advanced in between, in which case the counter we
+    // bumped could already have been checked. Back off and try again.
+    if (atomic_load(&epoch->current) == current) return current;
+    atomic_fetch_sub(&epoch->readers[current & 1], 1);
+  }
+}
+
+void epoch_exit(struct epoch* epoch, uint64_t entered) {
+  atomic_fetch_sub(&epoch->readers[entered & 1], 1);
+}
+
+void epoch_collect(struct epoch* epoch) {
+  uint64_t current = atomic_load(&epoch->current);
+  uint64_t previous = current - 1;
+
+  // Readers from before the current epoch could still hold memory retired
+  // during the previous one. Once they are gone it can be released and the
+  // epoch advanced, turning the now empty limbo into the one being filled.
+  if (atomic_load(&epoch->readers[previous & 1]) != 0) return;
+
+  epoch_limbo_release(epoch->limbo + (previous & 1));
+  atomic_store(&epoch->current, current + 1);
+}
+
+void epoch_retire(struct epoch* epoch, void* ptr, epoch_free_func* free_func) {
+  uint64_t current = atomic_load(&epoch->current);
+  struct epoch_limbo* limbo = epoch->limbo + (current & 1);
+
+  if (limbo->count >= limbo->capacity) {
+    limbo->capacity = limbo->capacity ? 2 * limbo->capacity : 16;
+    limbo->items = realloc(limbo->items,
+                           sizeof(struct epoch_retired) * limbo->capacity);
+  }
+
+  limbo->items[limbo->count].ptr = ptr;
+  limbo->items[limbo->count].free = free_func;
+  limbo->count++;
+
+  epoch_collect(epoch);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Epoch based reclamation for read-mostly structures: readers enter and leave
+// an epoch without ever blocking, while the single writer retires memory
+// which is only released once every reader that could still see it has left.
+// Readers never wait for the writer and the writer never waits for readers.
+#define EPOCH_FREE_FUNC(name) void name(void* ptr)
+typedef EPOCH_FREE_FUNC(epoch_free_func);
+
+struct epoch_retired
+{
+  void* ptr;
+  epoch_free_func* free;
+};
+struct epoch_limbo
+{
+  int count;
+  int capacity;
+  struct epoch_retired* items;
+};
+struct epoch
+{
+  atomic_uint_fast64_t current;
+  atomic_int readers[2];
+  struct epoch_limbo limbo[2];
+};
+
+void epoch_init(struct epoch* epoch);
+void epoch_free(struct epoch* epoch);
+
+uint64_t epoch_enter(struct epoch* epoch);
+void epoch_exit(struct epoch* epoch, uint64_t entered);
+
+void epoch_retire(struct epoch* epoch, void* ptr, epoch_free_func* free_func);
+void epoch_collect(struct epoch* epoch);
@@ -3,9 +3,19 @@
 #include "windows.h"
 #include "border.h"
 #include "misc/window.h"
+#include "gradient_animation.h"
 
-extern struct table g_windows;
+extern struct windows g_windows;
 extern pid_t g_pid;
+extern struct animation g_gradient_animator;
+extern struct gradient_animation_state g_gradient_anim_state;
+
+// The gradient animation only runs while an animated border is visible
+static void animation_visibility_update() {
+  gradient_animation_update_visibility(&g_gradient_animator,
+                                       &g_gradient_anim_state,
+                                       &g_windows             );
+}
 
 #ifdef DEBUG
 static void dump_event(void* data, size_t data_length) {
@@ -36,7 +46,7 @@ static bool is_own_window(int cid, uint32_t wid) {
 }
 
 static void window_spawn_handler(uint32_t event, struct window_spawn_data* data, size_t _, int cid) {
-  struct table* windows = &g_windows;
+  struct windows* windows = &g_windows;
   uint32_t wid = data->wid;
   uint64_t sid = data->sid;
 
@@ -53,11 +63,12 @@ static void window_spawn_handler(uint32_t event, struct window_spawn_data* data,
     }
     windows_determine_and_focus_active_window(windows);
   }
+  animation_visibility_update();
 }
 
 static void window_modify_handler(uint32_t event, uint32_t* window_id, size_t _, int cid) {
   uint32_t wid = *window_id;
-  struct table* windows = &g_windows;
+  struct windows* windows = &g_windows;
 
   if (is_own_window(cid, wid)) return;
 
@@ -72,6 +83,7 @@ static void window_modify_handler(uint32_t event, uint32_t* window_id, size_t _,
     windows_window_update(windows, wid);
     DELAY_ASYNC_EXEC_ON_MAIN_THREAD(10000, {
       windows_determine_and_focus_active_window(windows);
+      animation_visibility_update();
     });
   } else if (event == EVENT_WINDOW_LEVEL) {
     debug("Window Level: %d\n", wid);
@@ -80,16 +92,20 @@ static void window_modify_handler(uint32_t event, uint32_t* window_id, size_t _,
     debug("Window Focus\n");
     DELAY_ASYNC_EXEC_ON_MAIN_THREAD(50000, {
       windows_determine_and_focus_active_window(windows);
+      animation_visibility_update();
     });
   } else if (event == EVENT_WINDOW_UNHIDE) {
     debug("Window Unhide: %d\n", wid);
     windows_window_unhide(windows, wid);
+    animation_visibility_update();
   } else if (event == EVENT_WINDOW_HIDE) {
     debug("Window Hide: %d\n", wid);
     windows_window_hide(windows, wid);
+    animation_visibility_update();
   } else if (event == EVENT_WINDOW_CLOSE) {
     debug("Window Close: %d\n", wid);
     windows_window_destroy(windows, wid, 0);
+    animation_visibility_update();
   }
 }
 
@@ -97,6 +113,7 @@ static void front_app_handler() {
   debug("Window Focus\n");
   DELAY_ASYNC_EXEC_ON_MAIN_THREAD(50000, {
     windows_determine_and_focus_active_window(&g_windows);
+    animation_visibility_update();
   });
 }
 
@@ -104,6 +121,7 @@ static void space_handler() {
   // Not all native-fullscreen windows have yet updated their space id...
   DELAY_ASYNC_EXEC_ON_MAIN_THREAD(20000, {
     windows_draw_borders_on_current_spaces(&g_windows);
+    animation_visibility_update();
   });
 }
 
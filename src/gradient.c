@@ -0,0 +1,617 @@
+#include "gradient.h"
+#include "settings.h"
+#include "blend.h"
+#include "oklab.h"
+#include "angle.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Resolution of the blend between two table entries
+#define GRADIENT_FRAME_FRACTION 256
+
+static inline uint32_t gradient_random(struct gradient_track* track) {
+  uint32_t x = track->random;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  track->random = x;
+  return x;
+}
+
+// Shuffles the palette indices, the first index of the new permutation never
+// equals the last one of the previous so no color is repeated at the seam
+static void gradient_shuffle(struct gradient_track* track) {
+  int count = track->params.palette_count;
+  int last = track->shuffle[count - 1];
+  for (int i = count - 1; i > 0; i--) {
+    int j = gradient_random(track) % (i + 1);
+    int index = track->shuffle[i];
+    track->shuffle[i] = track->shuffle[j];
+    track->shuffle[j] = index;
+  }
+
+  if (track->shuffle[0] == last) {
+    int j = 1 + gradient_random(track) % (count - 1);
+    track->shuffle[0] = track->shuffle[j];
+    track->shuffle[j] = last;
+  }
+  track->shuffle_position = 0;
+}
+
+// Advances the sequence orders by one palette index. Consecutive indices
+// always differ, hence so do consecutive pairs.
+static int gradient_next_index(struct gradient_track* track) {
+  int count = track->params.palette_count;
+  switch (track->params.order) {
+    case GRADIENT_ORDER_PINGPONG: {
+      int next = track->sequence_index + track->sequence_direction;
+      if (next < 0 || next >= count) {
+        track->sequence_direction = -track->sequence_direction;
+        next = track->sequence_index + track->sequence_direction;
+      }
+      track->sequence_index = next;
+    } break;
+    case GRADIENT_ORDER_SHUFFLE: {
+      if (++track->shuffle_position >= count) gradient_shuffle(track);
+      track->sequence_index = track->shuffle[track->shuffle_position];
+    } break;
+    default: {
+      track->sequence_index = (track->sequence_index + 1) % count;
+    } break;
+  }
+  return track->sequence_index;
+}
+
+// Picks the next pair of colors. The two colors of a pair always differ and
+// a pair never repeats back to back.
+static void gradient_pick_colors(struct gradient_track* track, uint32_t* tl_color, uint32_t* br_color) {
+  struct gradient_params* params = &track->params;
+  if (params->palette_count < 2) {
+    *tl_color = 0xff000000;
+    *br_color = 0xff000000;
+    return;
+  }
+
+  int tl, br;
+  if (params->order == GRADIENT_ORDER_RANDOM) {
+    tl = gradient_random(track) % params->palette_count;
+    br = gradient_random(track) % (params->palette_count - 1);
+    if (br >= tl) br++;
+
+    // Swapping the colors yields a different pair since they differ
+    if (tl == track->previous_tl && br == track->previous_br) {
+      br = tl;
+      tl = track->previous_br;
+    }
+    track->previous_tl = tl;
+    track->previous_br = br;
+  } else {
+    // A pair continues where the previous one ended: (a, b), (b, c), ...
+    tl = track->sequence_index;
+    br = gradient_next_index(track);
+  }
+
+  *tl_color = params->palette[tl];
+  *br_color = params->palette[br];
+}
+
+static void gradient_sequence_start(struct gradient_track* track) {
+  int count = track->params.palette_count;
+  track->sequence_index = 0;
+  track->sequence_direction = 1;
+  track->previous_tl = -1;
+  track->previous_br = -1;
+
+  free(track->shuffle);
+  track->shuffle = NULL;
+  if (track->params.order == GRADIENT_ORDER_SHUFFLE && count >= 2) {
+    track->shuffle = malloc(sizeof(int) * count);
+    for (int i = 0; i < count; i++) track->shuffle[i] = i;
+    gradient_shuffle(track);
+    track->sequence_index = track->shuffle[0];
+  }
+}
+
+// Builds the interpolation tables of a transition. The tables are only
+// reallocated when the number of steps changed. In OKLab the endpoints are
+// converted once here, so a frame costs the same lookup in either space.
+static void gradient_build_transition(struct gradient_transition* transition, int steps, int color_space) {
+  if (transition->steps != steps || !transition->tl_colors) {
+    free(transition->tl_colors);
+    free(transition->br_colors);
+    transition->tl_colors = malloc(sizeof(uint32_t) * (steps + 1));
+    transition->br_colors = malloc(sizeof(uint32_t) * (steps + 1));
+    transition->steps = steps;
+  }
+
+  if (color_space == GRADIENT_SPACE_OKLAB) {
+    oklab_color_steps(transition->from_tl_color,
+                      transition->to_tl_color,
+                      transition->tl_colors,
+                      steps                   );
+    oklab_color_steps(transition->from_br_color,
+                      transition->to_br_color,
+                      transition->br_colors,
+                      steps                   );
+    return;
+  }
+
+  blend_color_steps(transition->from_tl_color,
+                    transition->to_tl_color,
+                    transition->tl_colors,
+                    steps                   );
+  blend_color_steps(transition->from_br_color,
+                    transition->to_br_color,
+                    transition->br_colors,
+                    steps                   );
+}
+
+// Prepares the transition following `from` in the given buffer: it starts
+// where `from` ends and heads to a freshly picked pair of colors.
+static void gradient_prepare_next(struct gradient_track* track, struct gradient_transition* from, struct gradient_transition* next) {
+  next->from_tl_color = from->to_tl_color;
+  next->from_br_color = from->to_br_color;
+  gradient_pick_colors(track, &next->to_tl_color, &next->to_br_color);
+  gradient_build_transition(next,
+                            track->params.steps,
+                            track->params.color_space);
+}
+
+static void gradient_free_transition(struct gradient_transition* transition) {
+  free(transition->tl_colors);
+  free(transition->br_colors);
+  memset(transition, 0, sizeof(struct gradient_transition));
+}
+
+static void gradient_track_start(struct gradient_track* track, uint32_t seed) {
+  track->random = seed ? seed : 0x9e3779b9;
+  gradient_sequence_start(track);
+  timeline_init(&track->timeline, track->params.period, track->params.phase);
+  track->transition_index = 0;
+  track->colors = 0;
+  track->applied_colors = 0;
+  timeline_init(&track->rotation,
+                track->params.rotation_period < 0
+                ? -track->params.rotation_period
+                : track->params.rotation_period,
+                0                                 );
+  track->angle = track->params.angle & ANGLE_MASK;
+  track->applied_angle = track->angle;
+
+  // Pick the initial pair of colors and build the tables of the first
+  // transition as well as the one following it
+  struct gradient_transition* first = &track->transitions[0];
+  gradient_pick_colors(track, &first->from_tl_color, &first->from_br_color);
+  gradient_pick_colors(track, &first->to_tl_color, &first->to_br_color);
+  gradient_build_transition(first,
+                            track->params.steps,
+                            track->params.color_space);
+  gradient_prepare_next(track, first, &track->transitions[1]);
+  track->active_transition = 0;
+}
+
+struct gradient_palette* gradient_palette_create(uint32_t* colors, int count) {
+  if (count <= 0) return NULL;
+  struct gradient_palette* palette = malloc(sizeof(struct gradient_palette)
+                                            + sizeof(uint32_t) * count      );
+  atomic_init(&palette->refs, 1);
+  palette->count = count;
+  memcpy(palette->colors, colors, sizeof(uint32_t) * count);
+  return palette;
+}
+
+void gradient_palette_retain(struct gradient_palette* palette) {
+  if (palette) atomic_fetch_add_explicit(&palette->refs, 1, memory_order_relaxed);
+}
+
+void gradient_palette_release(struct gradient_palette* palette) {
+  if (palette && atomic_fetch_sub_explicit(&palette->refs,
+                                           1,
+                                           memory_order_acq_rel) == 1) {
+    free(palette);
+  }
+}
+
+static struct gradient_snapshot* gradient_snapshot_create(struct gradient_params* params, uint32_t seed) {
+  struct gradient_snapshot* snapshot
+                       = malloc(sizeof(struct gradient_snapshot)
+                                + sizeof(uint32_t) * params->palette_count);
+  atomic_init(&snapshot->refs, 1);
+  snapshot->params = *params;
+  snapshot->params.steps = params->steps > 0 ? params->steps : 1;
+  snapshot->params.palette = snapshot->palette;
+  snapshot->seed = seed;
+  if (params->easing.type != EASING_LINEAR) {
+    easing_build_table(&snapshot->params.easing, snapshot->easing);
+  }
+  memcpy(snapshot->palette,
+         params->palette,
+         sizeof(uint32_t) * params->palette_count);
+  return snapshot;
+}
+
+static struct gradient_snapshot* gradient_snapshot_retain(struct gradient_snapshot* snapshot) {
+  atomic_fetch_add_explicit(&snapshot->refs, 1, memory_order_relaxed);
+  return snapshot;
+}
+
+static void gradient_snapshot_release(struct gradient_snapshot* snapshot) {
+  if (snapshot && atomic_fetch_sub_explicit(&snapshot->refs,
+                                            1,
+                                            memory_order_acq_rel) == 1) {
+    free(snapshot);
+  }
+}
+
+static void gradient_track_destroy(struct gradient_track* track) {
+  gradient_free_transition(&track->transitions[0]);
+  gradient_free_transition(&track->transitions[1]);
+  gradient_snapshot_release(track->snapshot);
+  gradient_snapshot_release(atomic_load(&track->pending));
+  gradient_snapshot_release(track->published);
+  free(track->shuffle);
+  free(track);
+}
+
+static bool gradient_params_equal(struct gradient_params* a, struct gradient_params* b) {
+  return a->palette_count == b->palette_count
+         && a->order == b->order
+         && a->seed == b->seed
+         && a->steps == b->steps
+         && a->color_space == b->color_space
+         && a->period == b->period
+         && a->phase == b->phase
+         && a->rate == b->rate
+         && a->angled == b->angled
+         && a->angle == b->angle
+         && a->rotation_period == b->rotation_period
+         && a->easing.type == b->easing.type
+         && (a->easing.type != EASING_CUBIC_BEZIER
+             || (a->easing.x1 == b->easing.x1
+                 && a->easing.y1 == b->easing.y1
+                 && a->easing.x2 == b->easing.x2
+                 && a->easing.y2 == b->easing.y2))
+         && memcmp(a->palette,
+                   b->palette,
+                   sizeof(uint32_t) * a->palette_count) == 0;
+}
+
+// Returns whether the angle of the track changed
+static bool gradient_track_rotate(struct gradient_track* track, uint64_t now) {
+  if (!track->params.angled || !track->params.rotation_period) return false;
+
+  uint64_t turn;
+  double progress;
+  timeline_position(&track->rotation, now, &turn, &progress);
+  uint32_t offset = (uint32_t)(progress * ANGLE_STEPS + 0.5);
+  if (track->params.rotation_period < 0) offset = ANGLE_STEPS - offset;
+
+  uint32_t angle = (track->params.angle + offset) & ANGLE_MASK;
+  if (angle == track->angle) return false;
+  track->angle = angle;
+  return true;
+}
+
+// Returns whether the colors or the angle of the track changed
+static bool gradient_track_advance(struct gradient_track* track, uint64_t now) {
+  uint64_t transition_index;
+  double progress;
+  timeline_position(&track->timeline, now, &transition_index, &progress);
+  if (track->easing) progress = easing_apply(track->easing, progress);
+
+  if (transition_index != track->transition_index) {
+    // The tables of the new transition were built ahead of time, the
+    // buffer it leaves behind is refilled with the one after it. After a
+    // long gap (sleep) the skipped transitions are not replayed, the
+    // animation simply continues from the colors it was showing.
+    track->transition_index = transition_index;
+    struct gradient_transition* previous
+                             = &track->transitions[track->active_transition];
+    track->active_transition ^= 1;
+    gradient_prepare_next(track,
+                          &track->transitions[track->active_transition],
+                          previous                                      );
+  }
+
+  // Continuous interpolation between the two table entries around the
+  // exact position
+  struct gradient_transition* transition
+                             = &track->transitions[track->active_transition];
+  double position = progress * transition->steps;
+  int step = (int)position;
+  if (step >= transition->steps) step = transition->steps - 1;
+  int fraction = (int)((position - step) * GRADIENT_FRAME_FRACTION + 0.5);
+
+  uint32_t from[2] = { transition->tl_colors[step],
+                       transition->br_colors[step] };
+  uint32_t to[2] = { transition->tl_colors[step + 1],
+                     transition->br_colors[step + 1] };
+  uint32_t colors[2];
+  blend_colors(from, to, colors, 2, fraction, GRADIENT_FRAME_FRACTION);
+
+  uint64_t packed = ((uint64_t)colors[0] << 32) | colors[1];
+  bool changed = packed != track->colors;
+  track->colors = packed;
+  return gradient_track_rotate(track, now) || changed;
+}
+
+static uint32_t gradient_divider(struct gradient_ticker* ticker, float rate) {
+  if (rate <= 0.f || rate >= ticker->frame_rate) return 1;
+  return (uint32_t)(ticker->frame_rate / rate + 0.5);
+}
+
+static struct gradient_track* gradient_ticker_find(struct gradient_ticker* ticker, uint64_t handle, int target, int* index) {
+  for (int i = 0; i < ticker->count; i++) {
+    if (ticker->tracks[i]->handle == handle
+        && ticker->tracks[i]->target == target) {
+      if (index) *index = i;
+      return ticker->tracks[i];
+    }
+  }
+  return NULL;
+}
+
+// Restarts the animation of the track with the snapshot, whose reference the
+// track takes over
+static void gradient_track_configure(struct gradient_ticker* ticker, struct gradient_track* track, struct gradient_snapshot* snapshot) {
+  gradient_snapshot_release(track->snapshot);
+  track->snapshot = snapshot;
+  track->params = snapshot->params;
+  track->easing = snapshot->params.easing.type != EASING_LINEAR
+                  ? snapshot->easing
+                  : NULL;
+  track->divider = gradient_divider(ticker, track->params.rate);
+  track->pending_frames = 0;
+  gradient_track_start(track, snapshot->seed);
+}
+
+void gradient_ticker_init(struct gradient_ticker* ticker) {
+  memset(ticker, 0, sizeof(struct gradient_ticker));
+  pthread_mutex_init(&ticker->mutex, NULL);
+  ticker->frame_rate = GRADIENT_DEFAULT_FRAME_RATE;
+}
+
+void gradient_ticker_set_frame_rate(struct gradient_ticker* ticker, double frame_rate) {
+  pthread_mutex_lock(&ticker->mutex);
+  if (frame_rate > 0) ticker->frame_rate = frame_rate;
+  for (int i = 0; i < ticker->count; i++) {
+    struct gradient_track* track = ticker->tracks[i];
+    track->divider = gradient_divider(ticker, track->params.rate);
+  }
+  pthread_mutex_unlock(&ticker->mutex);
+}
+
+void gradient_ticker_free(struct gradient_ticker* ticker) {
+  pthread_mutex_lock(&ticker->mutex);
+  for (int i = 0; i < ticker->count; i++) {
+    gradient_track_destroy(ticker->tracks[i]);
+  }
+  free(ticker->tracks);
+  ticker->tracks = NULL;
+  ticker->count = 0;
+  ticker->capacity = 0;
+  pthread_mutex_unlock(&ticker->mutex);
+  pthread_mutex_destroy(&ticker->mutex);
+}
+
+void gradient_ticker_set(struct gradient_ticker* ticker, uint64_t handle, int target, struct gradient_params* params, uint32_t seed) {
+  // The writer of the track list reads it without the lock
+  struct gradient_track* track = gradient_ticker_find(ticker, handle, target, NULL);
+  if (track && gradient_params_equal(&track->published->params, params)) {
+    return;
+  }
+
+  struct gradient_snapshot* snapshot = gradient_snapshot_create(params, seed);
+  if (track) {
+    gradient_snapshot_release(track->published);
+    track->published = gradient_snapshot_retain(snapshot);
+
+    // A snapshot which was not picked up yet is never seen by the ticker
+    gradient_snapshot_release(atomic_exchange_explicit(&track->pending,
+                                                       snapshot,
+                                                       memory_order_acq_rel));
+    return;
+  }
+
+  track = calloc(1, sizeof(struct gradient_track));
+  track->handle = handle;
+  track->target = target;
+  track->published = gradient_snapshot_retain(snapshot);
+  atomic_init(&track->pending, NULL);
+
+  pthread_mutex_lock(&ticker->mutex);
+  gradient_track_configure(ticker, track, snapshot);
+  if (ticker->count == ticker->capacity) {
+    ticker->capacity = ticker->capacity ? 2 * ticker->capacity : 8;
+    ticker->tracks = realloc(ticker->tracks,
+                             sizeof(struct gradient_track*)
+                             * ticker->capacity            );
+  }
+  ticker->tracks[ticker->count++] = track;
+  pthread_mutex_unlock(&ticker->mutex);
+}
+
+void gradient_ticker_remove(struct gradient_ticker* ticker, uint64_t handle, int target) {
+  int index;
+  struct gradient_track* track = gradient_ticker_find(ticker, handle, target, &index);
+  if (!track) return;
+
+  pthread_mutex_lock(&ticker->mutex);
+  ticker->tracks[index] = ticker->tracks[--ticker->count];
+  pthread_mutex_unlock(&ticker->mutex);
+  gradient_track_destroy(track);
+}
+
+int gradient_ticker_tick(struct gradient_ticker* ticker, uint64_t now) {
+  int changed = 0;
+  pthread_mutex_lock(&ticker->mutex);
+  ticker->frame++;
+  for (int i = 0; i < ticker->count; i++) {
+    struct gradient_track* track = ticker->tracks[i];
+    if (atomic_load_explicit(&track->pending, memory_order_relaxed)) {
+      gradient_track_configure(ticker,
+                               track,
+                               atomic_exchange_explicit(&track->pending,
+                                                        NULL,
+                                                        memory_order_acq_rel));
+    }
+    if (gradient_track_advance(track, now)) {
+      track->pending_frames = track->divider;
+      changed++;
+    } else if (track->pending_frames > 1) {
+      track->pending_frames--;
+      changed++;
+    }
+  }
+  pthread_mutex_unlock(&ticker->mutex);
+  return changed;
+}
+
+void gradient_dispatch_reset(struct gradient_dispatch* dispatch) {
+  atomic_store(&dispatch->queued, false);
+  atomic_store(&dispatch->queue_depth, 0);
+  atomic_store(&dispatch->max_queue_depth, 0);
+  atomic_store(&dispatch->dispatched, 0);
+  atomic_store(&dispatch->coalesced, 0);
+  atomic_store(&dispatch->unchanged, 0);
+}
+
+bool gradient_dispatch_frame(struct gradient_dispatch* dispatch, struct gradient_ticker* ticker, uint64_t now) {
+  if (gradient_ticker_tick(ticker, now) == 0) {
+    atomic_fetch_add(&dispatch->unchanged, 1);
+    return false;
+  }
+
+  if (atomic_exchange(&dispatch->queued, true)) {
+    atomic_fetch_add(&dispatch->coalesced, 1);
+    return false;
+  }
+
+  int depth = atomic_fetch_add(&dispatch->queue_depth, 1) + 1;
+  int max_depth = atomic_load(&dispatch->max_queue_depth);
+  while (depth > max_depth
+         && !atomic_compare_exchange_weak(&dispatch->max_queue_depth,
+                                          &max_depth,
+                                          depth                       ));
+  atomic_fetch_add(&dispatch->dispatched, 1);
+  return true;
+}
+
+void gradient_dispatch_dequeue(struct gradient_dispatch* dispatch) {
+  atomic_store(&dispatch->queued, false);
+  atomic_fetch_sub(&dispatch->queue_depth, 1);
+}
+
+void gradient_pacing_reset(struct gradient_pacing* pacing) {
+  atomic_store(&pacing->last_tick, 0);
+  atomic_store(&pacing->queued_at, 0);
+  histogram_reset(&pacing->jitter);
+  histogram_reset(&pacing->missed);
+  histogram_reset(&pacing->latency);
+  histogram_reset(&pacing->draw);
+}
+
+void gradient_pacing_restart(struct gradient_pacing* pacing) {
+  atomic_store(&pacing->last_tick, 0);
+}
+
+void gradient_pacing_tick(struct gradient_pacing* pacing, uint64_t time, uint64_t period) {
+  uint64_t last = atomic_exchange_explicit(&pacing->last_tick,
+                                           time,
+                                           memory_order_relaxed);
+  if (!last || !period || time <= last) return;
+
+  // The interval is rounded to whole vsyncs, the rest is jitter
+  uint64_t interval = time - last;
+  uint64_t vsyncs = (interval + period / 2) / period;
+  uint64_t grid = vsyncs * period;
+  histogram_record(&pacing->jitter, interval > grid ? interval - grid
+                                                    : grid - interval);
+  histogram_record(&pacing->missed, vsyncs > 1 ? vsyncs - 1 : 0);
+}
+
+void gradient_pacing_queued(struct gradient_pacing* pacing, uint64_t now) {
+  atomic_store_explicit(&pacing->queued_at, now, memory_order_relaxed);
+}
+
+void gradient_pacing_dequeued(struct gradient_pacing* pacing, uint64_t now) {
+  uint64_t queued_at = atomic_load_explicit(&pacing->queued_at,
+                                            memory_order_relaxed);
+  if (queued_at && now >= queued_at) {
+    histogram_record(&pacing->latency, now - queued_at);
+  }
+}
+
+void gradient_pacing_drawn(struct gradient_pacing* pacing, uint64_t start, uint64_t end) {
+  histogram_record(&pacing->draw, end >= start ? end - start : 0);
+}
+
+bool gradient_frame_tick(struct gradient_dispatch* dispatch,
+                         struct gradient_pacing* pacing,
+                         struct gradient_ticker* ticker,
+                         uint64_t time,
+                         uint64_t time_ns,
+                         uint64_t period_ns,
+                         uint64_t now) {
+  gradient_pacing_tick(pacing, time_ns, period_ns);
+
+  // All tracks advance in one pass from the output timestamp of the frame,
+  // a block is only queued if none is queued yet
+  if (!gradient_dispatch_frame(dispatch, ticker, time)) return false;
+  gradient_pacing_queued(pacing, now);
+  return true;
+}
+
+void gradient_frame_dequeue(struct gradient_dispatch* dispatch,
+                            struct gradient_pacing* pacing,
+                            uint64_t now) {
+  gradient_pacing_dequeued(pacing, now);
+  gradient_dispatch_dequeue(dispatch);
+}
+
+void gradient_pacing_print(struct gradient_pacing* pacing, FILE* file) {
+  histogram_print(&pacing->jitter, file, "callback jitter", "us", 1e3);
+  histogram_print(&pacing->latency, file, "dispatch latency", "us", 1e3);
+  histogram_print(&pacing->draw, file, "border draw", "us", 1e3);
+  histogram_print(&pacing->missed, file, "missed vsyncs", "", 1.0);
+}
+
+void gradient_idle_init(struct gradient_idle* idle, uint64_t grace) {
+  memset(idle, 0, sizeof(struct gradient_idle));
+  idle->grace = grace;
+}
+
+void gradient_idle_rechecked(struct gradient_idle* idle) {
+  idle->recheck_pending = false;
+}
+
+int gradient_idle_update(struct gradient_idle* idle, bool animated, bool visible, uint64_t now) {
+  if (animated && visible) {
+    idle->hiding = false;
+    if (idle->running) return GRADIENT_IDLE_NONE;
+    idle->running = true;
+    idle->starts++;
+    return GRADIENT_IDLE_START;
+  }
+
+  if (!idle->running) return GRADIENT_IDLE_NONE;
+
+  // Nothing left to animate stops at once, hidden animations after the grace.
+  // Events during the grace do not pile up rechecks behind the pending one.
+  if (animated) {
+    if (!idle->hiding) {
+      idle->hiding = true;
+      idle->hidden_since = now;
+    }
+    if (now - idle->hidden_since < idle->grace) {
+      if (idle->recheck_pending) return GRADIENT_IDLE_NONE;
+      idle->recheck_pending = true;
+      return GRADIENT_IDLE_RECHECK;
+    }
+    idle->suspends++;
+  }
+
+  idle->hiding = false;
+  idle->running = false;
+  return GRADIENT_IDLE_STOP;
+}
@@ -0,0 +1,276 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "timeline.h"
+#include "easing.h"
+#include "histogram.h"
+
+// Animated gradients, independent of the display link driving them: every
+// animated border owns a track and a single ticker advances all tracks from
+// one clock, reporting which of them changed color.
+
+#define GRADIENT_TRACK_GLOBAL 0
+
+// The color style of the border a track animates
+#define GRADIENT_TARGET_ACTIVE 0
+#define GRADIENT_TARGET_INACTIVE 1
+
+// Assumed display rate until the ticker is told the real one
+#define GRADIENT_DEFAULT_FRAME_RATE 60.0
+
+// One colour transition with the interpolated colours of every step
+// precomputed, a frame blends the two entries around its position.
+struct gradient_transition {
+  uint32_t from_tl_color;
+  uint32_t from_br_color;
+  uint32_t to_tl_color;
+  uint32_t to_br_color;
+
+  int steps;                  // Tables hold steps + 1 entries
+  uint32_t* tl_colors;
+  uint32_t* br_colors;
+};
+
+struct gradient_params {
+  uint32_t* palette;
+  int palette_count;
+  int order;                  // Sequencing of the palette, GRADIENT_ORDER_*
+  uint32_t seed;              // Seed from the settings, 0 if unseeded
+  int steps;                  // Table resolution of a transition
+  int color_space;
+  uint64_t period;            // Clock ticks per transition (after speed)
+  uint64_t phase;             // Clock ticks the track is ahead of its start
+  float rate;                 // Redraws per second of a border, 0 every frame
+  struct easing easing;       // Curve of the progress within a transition
+
+  // Direction of the gradient: corner to corner unless angled, in which case
+  // it starts at angle (ANGLE_STEPS) and turns once every rotation period
+  // clock ticks, counterclockwise if negative and not at all if 0
+  bool angled;
+  uint32_t angle;
+  int64_t rotation_period;
+};
+
+// Immutable palette of a settings struct, shared by its copies. The settings
+// owning one (g_settings and the overrides of the borders) hold a reference.
+struct gradient_palette {
+  atomic_int refs;
+  int count;
+  uint32_t colors[];
+};
+
+// Returns a palette holding one reference, NULL if count is 0
+struct gradient_palette* gradient_palette_create(uint32_t* colors, int count);
+void gradient_palette_retain(struct gradient_palette* palette);
+void gradient_palette_release(struct gradient_palette* palette);
+
+// Immutable configuration of a track with its own copy of the palette. The
+// main thread publishes a new one and the ticker swaps it in on its next
+// tick, neither of them waiting for the other.
+struct gradient_snapshot {
+  atomic_int refs;
+  struct gradient_params params;  // params.palette points to palette
+  uint32_t seed;
+  uint32_t easing[EASING_STEPS + 1];  // Built once unless the curve is linear
+  uint32_t palette[];
+};
+
+struct gradient_track {
+  uint64_t handle;            // Border handle, GRADIENT_TRACK_GLOBAL for g_settings
+  int target;                 // GRADIENT_TARGET_*
+
+  // The snapshot being animated (params is a copy of its params), the one
+  // waiting to be picked up by the ticker and the latest one published by the
+  // main thread, which only the main thread reads
+  struct gradient_snapshot* snapshot;
+  _Atomic(struct gradient_snapshot*) pending;
+  struct gradient_snapshot* published;
+  struct gradient_params params;
+  uint32_t* easing;           // Easing table of the snapshot, NULL if linear
+  uint32_t random;            // xorshift32 state
+
+  // Position in the palette sequence: the last index handed out, the walking
+  // direction of pingpong and the permutation of shuffle. Random remembers
+  // the previous pair instead.
+  int sequence_index;
+  int sequence_direction;
+  int shuffle_position;
+  int* shuffle;
+  int previous_tl;
+  int previous_br;
+
+  // The position is derived from the clock, the transition counter only
+  // tracks which transition the tables belong to.
+  struct timeline timeline;
+  uint64_t transition_index;
+
+  // Double buffered transitions: the active one is being displayed while
+  // the other already holds the tables of the transition following it.
+  struct gradient_transition transitions[2];
+  int active_transition;
+
+  uint64_t colors;            // tl << 32 | br of the latest tick
+  uint64_t applied_colors;    // Colors last drawn by the main thread
+
+  // A rotation only changes the angle, the colors are not rebuilt for it
+  struct timeline rotation;
+  uint32_t angle;
+  uint32_t applied_angle;
+
+  // Lower rate tracks keep reporting a change for one full redraw cycle, so
+  // every border gets its turn to catch up with the latest colors
+  uint32_t divider;
+  uint32_t pending_frames;
+};
+
+struct gradient_ticker {
+  pthread_mutex_t mutex;
+  struct gradient_track** tracks;
+  int count;
+  int capacity;
+
+  uint64_t frame;             // Number of ticks so far
+  double frame_rate;          // Ticks per second
+};
+
+void gradient_ticker_init(struct gradient_ticker* ticker);
+void gradient_ticker_free(struct gradient_ticker* ticker);
+
+// Decides when the clock driving the ticker runs. It only runs while there
+// are tracks and at least one of them is visible; once nothing animated is
+// visible it keeps running for a grace period, so short gaps (a focus
+// switch, a space animation) do not bounce it.
+#define GRADIENT_IDLE_NONE    0
+#define GRADIENT_IDLE_START   1
+#define GRADIENT_IDLE_STOP    2
+#define GRADIENT_IDLE_RECHECK 3   // Update again after the grace period
+
+struct gradient_idle {
+  bool running;
+  bool hiding;
+  bool recheck_pending;       // At most one recheck is scheduled at a time
+  uint64_t hidden_since;
+  uint64_t grace;
+
+  uint64_t starts;
+  uint64_t suspends;
+};
+
+void gradient_idle_init(struct gradient_idle* idle, uint64_t grace);
+int gradient_idle_update(struct gradient_idle* idle, bool animated, bool visible, uint64_t now);
+
+// Called by the scheduled recheck before it updates, so the update may
+// schedule the next one
+void gradient_idle_rechecked(struct gradient_idle* idle);
+
+// Hand-off of the frame colors to the main thread. At most one update is
+// queued at any time: the queued block applies the latest colors of every
+// track when it runs, and ticks which did not change any colors are not
+// sent at all.
+struct gradient_dispatch {
+  atomic_bool queued;
+
+  atomic_int queue_depth;
+  atomic_int max_queue_depth;
+  atomic_uint_fast64_t dispatched;  // Blocks queued on the main thread
+  atomic_uint_fast64_t coalesced;   // Ticks folded into a queued block
+  atomic_uint_fast64_t unchanged;   // Ticks skipped with the same colors
+};
+
+// Only once at init: the counters are cumulative, and resetting queued or
+// queue_depth while a block is in flight would unbalance its dequeue
+void gradient_dispatch_reset(struct gradient_dispatch* dispatch);
+
+// Ticks the tracks for the frame at now and returns whether the caller has to
+// queue a block applying the colors: they changed and no block is queued yet.
+bool gradient_dispatch_frame(struct gradient_dispatch* dispatch, struct gradient_ticker* ticker, uint64_t now);
+
+// Called by the queued block before it reads the colors, a tick changing
+// them after this point queues a block of its own
+void gradient_dispatch_dequeue(struct gradient_dispatch* dispatch);
+
+// Frame pacing of the animation in nanoseconds, one timestamp per stage of a
+// frame: the tick on the clock thread, the queued block starting on the main
+// thread and the redraw of each border on its update thread.
+struct gradient_pacing {
+  atomic_uint_fast64_t last_tick;
+  atomic_uint_fast64_t queued_at;
+
+  struct histogram jitter;    // Distance of a tick from the vsync grid
+  struct histogram missed;    // Vsyncs passed without a tick, per tick
+  struct histogram latency;   // From queuing a block until it runs
+  struct histogram draw;      // Redraw of one border, per border and frame
+};
+
+void gradient_pacing_reset(struct gradient_pacing* pacing);
+
+// Forgets the last tick, so a clock resuming after a pause does not count
+// the pause as missed vsyncs
+void gradient_pacing_restart(struct gradient_pacing* pacing);
+
+// Records the tick of a frame at time, period is the nominal frame duration
+void gradient_pacing_tick(struct gradient_pacing* pacing, uint64_t time, uint64_t period);
+
+// Records a block queued at now and the same block running at now
+void gradient_pacing_queued(struct gradient_pacing* pacing, uint64_t now);
+void gradient_pacing_dequeued(struct gradient_pacing* pacing, uint64_t now);
+
+// Records a border redraw from start to end, called by the thread drawing it
+void gradient_pacing_drawn(struct gradient_pacing* pacing, uint64_t start, uint64_t end);
+
+void gradient_pacing_print(struct gradient_pacing* pacing, FILE* file);
+
+// The clock thread half of an animation frame: records the tick at time_ns in
+// the pacing and ticks the tracks for the frame at time. Returns whether the
+// caller has to queue a block applying the colors, recorded as queued at now.
+bool gradient_frame_tick(struct gradient_dispatch* dispatch,
+                         struct gradient_pacing* pacing,
+                         struct gradient_ticker* ticker,
+                         uint64_t time,
+                         uint64_t time_ns,
+                         uint64_t period_ns,
+                         uint64_t now);
+
+// The main thread half: called by the queued block at now before it reads the
+// colors
+void gradient_frame_dequeue(struct gradient_dispatch* dispatch,
+                            struct gradient_pacing* pacing,
+                            uint64_t now);
+
+// Sets the display rate the lower rate tracks are divided from
+void gradient_ticker_set_frame_rate(struct gradient_ticker* ticker, double frame_rate);
+
+// Adds the track of handle and target or reconfigures it, the animation of an
+// existing track is only restarted when its parameters changed. The palette
+// is copied. The tracks are only added, reconfigured and removed by one
+// thread; a reconfiguration is published without taking the lock and applied
+// by the next tick.
+void gradient_ticker_set(struct gradient_ticker* ticker, uint64_t handle, int target, struct gradient_params* params, uint32_t seed);
+void gradient_ticker_remove(struct gradient_ticker* ticker, uint64_t handle, int target);
+
+// Advances every track to the clock value now in one pass and returns the
+// number of tracks whose colors or angle changed
+int gradient_ticker_tick(struct gradient_ticker* ticker, uint64_t now);
+
+static inline uint32_t gradient_track_tl_color(struct gradient_track* track) {
+  return track->colors >> 32;
+}
+
+static inline uint32_t gradient_track_br_color(struct gradient_track* track) {
+  return track->colors & 0xffffffff;
+}
+
+// Decides whether a border following a lower rate track is redrawn on this
+// frame. Each border is redrawn every divider frames, offset by its slot so
+// the redraws of many borders spread evenly over the frames in between. A
+// border which missed its frame is redrawn at once and stays on its grid.
+static inline bool gradient_tier_due(uint64_t frame, uint64_t* next_frame, uint32_t slot, uint32_t divider) {
+  if (divider <= 1) return true;
+  uint64_t offset = (frame + slot) % divider;
+  if (*next_frame == 0) *next_frame = offset ? frame + divider - offset : frame;
+  if (frame < *next_frame) return false;
+  *next_frame = frame + divider - offset;
+  return true;
+}
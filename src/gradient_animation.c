@@ -1,210 +1,411 @@
 #include "gradient_animation.h"
 #include "misc/extern.h" // For g_settings, g_windows (if needed directly, though dispatch is preferred)
-#include "windows.h"     // For windows_update_active
-#include <stdlib.h>      // For rand, srand
-#include <time.h>        // For time (to seed rand)
+#include "windows.h"     // For windows_get
+#include "angle.h"
+#include <stdlib.h>
+#include <time.h>        // For time (to seed the tracks)
 #include <stdio.h>       // For printf (debugging)
-#include <pthread.h>     // For pthread_once
 #include <dispatch/dispatch.h> // For GCD (dispatch_async, dispatch_get_main_queue)
+#include <CoreVideo/CoreVideo.h> // For CVGetHostClockFrequency
 
 // Ensure g_settings is available. It's declared in main.c
-// If there are issues with direct access, consider passing a pointer or using a getter.
 extern struct settings g_settings;
-extern struct table g_windows; // For windows_update_active
-
-// --- Helper: Dispatch to Main Thread ---
-// We need a robust way to ensure UI updates happen on the main thread.
-// The DELAY_ASYNC_EXEC_ON_MAIN_THREAD macro from events.c might be suitable,
-// or we can use dispatch_async directly.
-// For simplicity here, we'll assume direct calls and note where dispatch is needed.
-// A proper implementation would use:
-// #include <dispatch/dispatch.h>
-// dispatch_async(dispatch_get_main_queue(), ^{ /* update g_settings and call windows_update_active */ });
-
-// --- Color Utilities ---
-
-// Interpolates a single color channel (0-255)
-static uint8_t interpolate_channel(uint8_t c1, uint8_t c2, int step, int max_steps) {
-    if (step <= 0) return c1;
-    if (step >= max_steps) return c2;
-    // Linear interpolation: c1 + (c2 - c1) * step / max_steps
-    // Add 0.5 for rounding before truncation by int cast
-    return (uint8_t)(c1 + (double)(c2 - c1) * step / max_steps + 0.5);
+extern struct windows g_windows;
+extern struct gradient_cache g_gradient_cache;
+
+// How long the display link keeps running once nothing animated is visible
+#define GRADIENT_IDLE_GRACE_NSEC 250000000ull
+
+// Derives the track parameters from the animation settings, returns false if
+// the settings do not animate anything.
+static bool gradient_params_from_settings(struct settings* settings, struct gradient_params* params) {
+    if (!settings->animated_gradient_enabled ||
+        !settings->animated_gradient_palette ||
+        settings->animated_gradient_palette->count < 2) {
+        return false;
+    }
+
+    double duration_sec = settings->animated_gradient_duration_sec > 0
+                          ? settings->animated_gradient_duration_sec
+                          : 1.0;
+    double speed = settings->animated_gradient_speed > 0
+                   ? settings->animated_gradient_speed
+                   : 1.0;
+
+    // One transition lasts duration / speed, in host clock ticks
+    double period = duration_sec / speed * CVGetHostClockFrequency();
+
+    params->palette = settings->animated_gradient_palette->colors;
+    params->palette_count = settings->animated_gradient_palette->count;
+    params->order = settings->animated_gradient_order;
+    params->seed = settings->animated_gradient_seed;
+    params->steps = settings->animated_gradient_steps > 0 ? settings->animated_gradient_steps : 1;
+    params->color_space = settings->animated_gradient_space;
+    params->period = (uint64_t)period;
+    params->phase = (uint64_t)(settings->animated_gradient_phase * period);
+    params->rate = 0.f;
+    params->easing = settings->animated_gradient_easing;
+
+    // One turn lasts 360 / rotation seconds
+    params->angled = settings->animated_gradient_angled;
+    params->angle = angle_from_degrees(settings->animated_gradient_angle);
+    params->rotation_period = 0;
+    if (settings->animated_gradient_rotation != 0.f) {
+        params->rotation_period = (int64_t)(360.0
+                                            / settings->animated_gradient_rotation
+                                            * CVGetHostClockFrequency()          );
+    }
+    return true;
 }
 
-// Interpolates an ARGB color value (0xAARRGGBB)
-// Alpha is taken from color_from, or set to 0xFF if color_from's alpha is 0.
-static uint32_t interpolate_color_value(uint32_t color_from, uint32_t color_to, int step, int max_steps) {
-    uint8_t a1 = (color_from >> 24) & 0xFF;
-    uint8_t r1 = (color_from >> 16) & 0xFF;
-    uint8_t g1 = (color_from >> 8) & 0xFF;
-    uint8_t b1 = (color_from >> 0) & 0xFF;
-
-    // uint8_t a2 = (color_to >> 24) & 0xFF; // Alpha of target color, usually we want to keep source alpha or FF
-    uint8_t r2 = (color_to >> 16) & 0xFF;
-    uint8_t g2 = (color_to >> 8) & 0xFF;
-    uint8_t b2 = (color_to >> 0) & 0xFF;
-
-    uint8_t final_a = (a1 == 0) ? 0xFF : a1; // Use source alpha, or FF if source alpha is transparent
-    uint8_t final_r = interpolate_channel(r1, r2, step, max_steps);
-    uint8_t final_g = interpolate_channel(g1, g2, step, max_steps);
-    uint8_t final_b = interpolate_channel(b1, b2, step, max_steps);
-
-    return (final_a << 24) | (final_r << 16) | (final_g << 8) | final_b;
+// A fixed seed makes the sequence reproducible, it is mixed with the window
+// id (0 for g_settings) so borders sharing a seed do not animate in lockstep.
+// The inactive track follows the same palette at its own, lower rate.
+static void gradient_animation_sync_tracks(struct gradient_ticker* ticker, uint64_t handle, uint32_t wid, struct settings* settings) {
+    struct gradient_params params;
+    if (gradient_params_from_settings(settings, &params)) {
+        uint32_t seed = params.seed ? params.seed : (uint32_t)time(NULL);
+        seed ^= wid * 0x9e3779b9;
+        gradient_ticker_set(ticker, handle, GRADIENT_TARGET_ACTIVE, &params, seed);
+
+        if (settings->animated_gradient_inactive) {
+            params.rate = settings->animated_gradient_inactive_rate;
+            gradient_ticker_set(ticker,
+                                handle,
+                                GRADIENT_TARGET_INACTIVE,
+                                &params,
+                                seed ^ 0x85ebca6b        );
+        } else {
+            gradient_ticker_remove(ticker, handle, GRADIENT_TARGET_INACTIVE);
+        }
+    } else {
+        gradient_ticker_remove(ticker, handle, GRADIENT_TARGET_ACTIVE);
+        gradient_ticker_remove(ticker, handle, GRADIENT_TARGET_INACTIVE);
+    }
 }
 
-// Picks two different random colors from the palette
-static void pick_next_random_colors(struct gradient_animation_state* anim_state) {
-    if (!anim_state || !anim_state->color_palette || anim_state->num_palette_colors < 2) {
-        // Not enough colors to pick a pair, or invalid state
-        // Set to black or some default to indicate an error or stop animation
-        anim_state->next_tl_color = 0xFF000000;
-        anim_state->next_br_color = 0xFF000000;
-        return;
+// --- Main Thread Dispatch ---
+
+static void gradient_set_colors(struct color_style* style, struct gradient_track* track) {
+    style->stype = COLOR_STYLE_GRADIENT;
+    style->gradient.color1 = gradient_track_tl_color(track);
+    style->gradient.color2 = gradient_track_br_color(track);
+    if (track->params.angled) {
+        style->gradient.direction = ANGLE;
+        style->gradient.angle = track->angle;
+    } else {
+        style->gradient.direction = TL_TO_BR; // As per user's original script
     }
+}
 
-    int idx1 = rand() % anim_state->num_palette_colors;
-    int idx2;
-    do {
-        idx2 = rand() % anim_state->num_palette_colors;
-    } while (idx1 == idx2);
+// Inactive borders are redrawn at the lower rate of their track, spread over
+// the frames by the slot of their handle
+static bool gradient_inactive_due(struct border* border, struct gradient_track* track, uint64_t frame) {
+    if (border->focused
+        || (border->gradient_colors == track->colors
+            && border->gradient_angle == track->angle)) {
+        return false;
+    }
+    if (!gradient_tier_due(frame,
+                           &border->gradient_next_frame,
+                           SLOTMAP_HANDLE_INDEX(border->handle),
+                           track->divider                       )) {
+        return false;
+    }
+    border->gradient_colors = track->colors;
+    border->gradient_angle = track->angle;
+    return true;
+}
+
+// Applies the latest colors of every track which changed since it was last
+// drawn and redraws the affected borders. Runs on the main thread.
+static void gradient_animation_apply(struct gradient_animation_state* anim_state) {
+    struct gradient_ticker* ticker = &anim_state->ticker;
+
+    pthread_mutex_lock(&ticker->mutex);
+    struct border* redraw[ticker->count + g_windows.borders.count + 1];
+    struct gradient_track* removed[ticker->count + 1];
+    int redraw_count = 0;
+    int removed_count = 0;
+    uint64_t frame = ticker->frame;
+
+    for (int i = 0; i < ticker->count; i++) {
+        struct gradient_track* track = ticker->tracks[i];
+        if (!track->colors) continue;
+
+        if (track->target == GRADIENT_TARGET_INACTIVE) {
+            if (track->handle == GRADIENT_TRACK_GLOBAL) {
+                gradient_set_colors(&g_settings.inactive_window, track);
+                for (int j = 0; j < g_windows.borders.count; j++) {
+                    struct border* border = g_windows.borders.values[j];
+                    if (!border->setting_override.enabled
+                        && gradient_inactive_due(border, track, frame)) {
+                        redraw[redraw_count++] = border;
+                    }
+                }
+            } else {
+                struct border* border = windows_get(&g_windows, track->handle);
+                if (!border) {
+                    removed[removed_count++] = track;
+                    continue;
+                }
+
+                gradient_set_colors(&border->setting_override.inactive_window,
+                                    track                                     );
+                if (gradient_inactive_due(border, track, frame)) {
+                    redraw[redraw_count++] = border;
+                }
+            }
+            continue;
+        }
+
+        if (track->colors == track->applied_colors
+            && track->angle == track->applied_angle) {
+            continue;
+        }
+        track->applied_colors = track->colors;
+        track->applied_angle = track->angle;
+
+        if (track->handle == GRADIENT_TRACK_GLOBAL) {
+            gradient_set_colors(&g_settings.active_window, track);
+
+            // A focused border with overridden settings does not show them
+            struct border* border = g_windows.focused;
+            if (border && !border->setting_override.enabled) {
+                redraw[redraw_count++] = border;
+            }
+        } else {
+            struct border* border = windows_get(&g_windows, track->handle);
+            if (!border) {
+                removed[removed_count++] = track;
+                continue;
+            }
+
+            gradient_set_colors(&border->setting_override.active_window, track);
+            if (border->focused) redraw[redraw_count++] = border;
+        }
+    }
+
+    uint64_t removed_handles[removed_count + 1];
+    int removed_targets[removed_count + 1];
+    for (int i = 0; i < removed_count; i++) {
+        removed_handles[i] = removed[i]->handle;
+        removed_targets[i] = removed[i]->target;
+    }
+    pthread_mutex_unlock(&ticker->mutex);
 
-    anim_state->next_tl_color = anim_state->color_palette[idx1];
-    anim_state->next_br_color = anim_state->color_palette[idx2];
+    for (int i = 0; i < removed_count; i++) {
+        gradient_ticker_remove(ticker, removed_handles[i], removed_targets[i]);
+    }
+
+    // The redraws run on their own update threads, which record how long
+    // each of them took
+    for (int i = 0; i < redraw_count; i++) {
+        border_redraw_frame(redraw[i], &anim_state->pacing);
+    }
 }
 
+// Queues the application of the new colors on the main thread
+static void gradient_dispatch_colors(struct gradient_animation_state* anim_state) {
+    dispatch_async(dispatch_get_main_queue(), ^{
+        gradient_frame_dequeue(&anim_state->dispatch,
+                               &anim_state->pacing,
+                               clock_gettime_nsec_np(CLOCK_UPTIME_RAW));
+        gradient_animation_apply(anim_state);
+    });
+}
 
 // --- Animation Callback and Control ---
 
-// Initialization function for pthread_once to seed srand
-static void initialize_srand(void) {
-    srand(time(NULL));
+void gradient_animation_callback(struct animation* animation, uint64_t time) {
+    struct gradient_animation_state* anim_state = animation->context;
+    if (!anim_state) return; // Should not happen
+
+    if (gradient_frame_tick(&anim_state->dispatch,
+                            &anim_state->pacing,
+                            &anim_state->ticker,
+                            time,
+                            (uint64_t)(time * (1e9 / animation->frequency)),
+                            (uint64_t)(animation->frame_time * 1e3),
+                            clock_gettime_nsec_np(CLOCK_UPTIME_RAW)        )) {
+        gradient_dispatch_colors(anim_state);
+    }
+}
+
+void gradient_animation_init(struct gradient_animation_state* anim_state) {
+    gradient_ticker_init(&anim_state->ticker);
+    gradient_dispatch_reset(&anim_state->dispatch);
+    gradient_pacing_reset(&anim_state->pacing);
+    gradient_idle_init(&anim_state->idle, GRADIENT_IDLE_GRACE_NSEC);
 }
 
-CVReturn gradient_animation_callback(CVDisplayLinkRef displayLink,
-                                     const CVTimeStamp* now,
-                                     const CVTimeStamp* outputTime,
-                                     CVOptionFlags flagsIn,
-                                     CVOptionFlags* flagsOut,
-                                     void* displayLinkContext) {
-    struct animation* anim_controller = (struct animation*)displayLinkContext;
-    if (!anim_controller || !anim_controller->context) return kCVReturnError; // Should not happen
+// Sticky borders are indexed under space 0, which is always visible, so the
+// index answers for them without reading sticky behind an async update
+static bool gradient_border_visible(struct border* border) {
+    return border->wid
+           && !border->hidden
+           && !border->too_small
+           && border->space.list
+           && border->space.list->visible;
+}
 
-    struct gradient_animation_state* anim_state = (struct gradient_animation_state*)anim_controller->context;
+static bool gradient_track_visible(struct gradient_track* track, struct windows* windows) {
+    bool active = track->target == GRADIENT_TARGET_ACTIVE;
+    if (track->handle == GRADIENT_TRACK_GLOBAL) {
+        if (active) {
+            struct border* border = windows->focused;
+            return border
+                   && !border->setting_override.enabled
+                   && gradient_border_visible(border);
+        }
 
-    anim_state->time_accumulator_usec += anim_controller->frame_time;
+        for (int i = 0; i < windows->borders.count; i++) {
+            struct border* border = windows->borders.values[i];
+            if (!border->focused
+                && !border->setting_override.enabled
+                && gradient_border_visible(border)) {
+                return true;
+            }
+        }
+        return false;
+    }
 
-    bool needs_color_update = false;
+    struct border* border = windows_get(windows, track->handle);
+    return border
+           && border->focused == active
+           && gradient_border_visible(border);
+}
 
-    while (anim_state->time_accumulator_usec >= anim_state->step_duration_usec && anim_state->step_duration_usec > 0) {
-        anim_state->time_accumulator_usec -= anim_state->step_duration_usec;
-        anim_state->current_interpolation_step++;
-        needs_color_update = true;
+void gradient_animation_update_visibility(struct animation* animator,
+                                          struct gradient_animation_state* anim_state,
+                                          struct windows* windows) {
+    struct gradient_ticker* ticker = &anim_state->ticker;
+    pthread_mutex_lock(&ticker->mutex);
+    bool animated = ticker->count > 0;
+    bool visible = false;
+    for (int i = 0; i < ticker->count && !visible; i++) {
+        visible = gradient_track_visible(ticker->tracks[i], windows);
+    }
+    pthread_mutex_unlock(&ticker->mutex);
 
-        if (anim_state->current_interpolation_step > anim_state->palette_total_steps) {
-            anim_state->current_interpolation_step = 0; // Reset for the new pair
-            anim_state->current_tl_color = anim_state->next_tl_color;
-            anim_state->current_br_color = anim_state->next_br_color;
-            pick_next_random_colors(anim_state);
-            // The first step (0) of the new transition will use these new current/next colors
-        }
+    uint64_t now = clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW_APPROX);
+    switch (gradient_idle_update(&anim_state->idle, animated, visible, now)) {
+        case GRADIENT_IDLE_START: {
+            // The dispatch counters stay cumulative across suspends and a
+            // block queued before the suspend still dequeues itself, only
+            // the pacing forgets the ticks from before the gap
+            gradient_pacing_restart(&anim_state->pacing);
+            animation_init(animator);
+            // The callback receives 'animator', anim_state is reachable
+            // through animator->context.
+            animation_start(animator, gradient_animation_callback, anim_state);
+            if (animator->frame_time > 0) {
+                gradient_ticker_set_frame_rate(ticker, 1e6 / animator->frame_time);
+            }
+            printf("[+] Borders: Gradient animation started.\n");
+        } break;
+        case GRADIENT_IDLE_STOP: {
+            gradient_animation_stop(animator);
+        } break;
+        case GRADIENT_IDLE_RECHECK: {
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW,
+                                         GRADIENT_IDLE_GRACE_NSEC),
+                           dispatch_get_main_queue(),
+                           ^{
+                gradient_idle_rechecked(&anim_state->idle);
+                gradient_animation_update_visibility(animator, anim_state, windows);
+            });
+        } break;
     }
-    
-    if (needs_color_update || anim_state->current_interpolation_step == 0) { // Also update on first frame of new pair
-        uint32_t interpolated_tl, interpolated_br;
-
-        interpolated_tl = interpolate_color_value(anim_state->current_tl_color,
-                                                  anim_state->next_tl_color,
-                                                  anim_state->current_interpolation_step,
-                                                  anim_state->palette_total_steps);
-        interpolated_br = interpolate_color_value(anim_state->current_br_color,
-                                                  anim_state->next_br_color,
-                                                  anim_state->current_interpolation_step,
-                                                  anim_state->palette_total_steps);
-        
-        
-        // Dispatch the update of g_settings and the call to windows_update_active to the main thread.
-        // This is crucial because UI updates and functions asserting main thread execution (like border_get_settings)
-        // must run on the main thread.
-        dispatch_async(dispatch_get_main_queue(), ^{
-            // This block executes on the main thread.
-            // interpolated_tl and interpolated_br are captured by value.
-            g_settings.active_window.stype = COLOR_STYLE_GRADIENT;
-            g_settings.active_window.gradient.color1 = interpolated_tl;
-            g_settings.active_window.gradient.color2 = interpolated_br;
-            g_settings.active_window.gradient.direction = TL_TO_BR; // As per user's original script
-            
-            windows_update_active(&g_windows);
-        });
-    }
-
-    return kCVReturnSuccess;
 }
 
-void gradient_animation_init_and_start(struct animation* animator,
-                                       struct gradient_animation_state* anim_state,
-                                       struct settings* settings_ptr) { // Pass g_settings explicitly
-    if (!settings_ptr->animated_gradient_enabled ||
-        !settings_ptr->parsed_gradient_colors ||
-        settings_ptr->num_parsed_gradient_colors < 2) {
-        return; // Animation not enabled or not enough colors
-    }
-
-    // Seed random number generator once
-    static pthread_once_t rand_seeded = PTHREAD_ONCE_INIT;
-    pthread_once(&rand_seeded, initialize_srand);
-
-    anim_state->color_palette = settings_ptr->parsed_gradient_colors;
-    anim_state->num_palette_colors = settings_ptr->num_parsed_gradient_colors;
-    anim_state->palette_total_steps = settings_ptr->animated_gradient_steps > 0 ? settings_ptr->animated_gradient_steps : 1;
-    
-    if (anim_state->palette_total_steps > 0 && settings_ptr->animated_gradient_duration_sec > 0) {
-       anim_state->step_duration_usec = (settings_ptr->animated_gradient_duration_sec * 1000000.0) / anim_state->palette_total_steps;
-    } else {
-        anim_state->step_duration_usec = 1000000.0; // Default to 1 second per step if duration/steps are invalid
-    }
-
-    anim_state->current_interpolation_step = 0;
-    anim_state->time_accumulator_usec = 0;
-
-    // Pick initial pair of colors
-    pick_next_random_colors(anim_state); // This sets next_tl_color, next_br_color
-    anim_state->current_tl_color = anim_state->next_tl_color; // Start with the first "next" as current
-    anim_state->current_br_color = anim_state->next_br_color;
-    pick_next_random_colors(anim_state); // Pick a new "next" pair for the first transition
-
-    // Initialize and start the CVDisplayLink animation
-    animation_init(animator); // Initializes animator->link to NULL etc. animator->context to NULL.
-    
-    // The 'proc' argument to animation_start is our gradient_animation_callback.
-    // The 'context' argument to animation_start (which is anim_state here) will be stored in animator->context
-    // by animation_start itself. CVDisplayLinkSetOutputCallback will then be called with 'animator'
-    // as its own context argument, which is what our callback receives.
-    animation_start(animator, (void*)gradient_animation_callback, anim_state); // Pass anim_state as context for animation_start
-    
-    printf("[+] Borders: Gradient animation started.\n");
+void gradient_animation_update(struct animation* animator,
+                               struct gradient_animation_state* anim_state,
+                               struct windows* windows) {
+    struct gradient_ticker* ticker = &anim_state->ticker;
+    gradient_animation_sync_tracks(ticker, GRADIENT_TRACK_GLOBAL, 0, &g_settings);
+
+    for (int i = 0; i < windows->borders.count; i++) {
+        struct border* border = windows->borders.values[i];
+        if (border->setting_override.enabled) {
+            gradient_animation_sync_tracks(ticker,
+                                           border->handle,
+                                           border->target_wid,
+                                           &border->setting_override);
+        }
+    }
+
+    // Tracks of borders which are gone or no longer override the settings
+    pthread_mutex_lock(&ticker->mutex);
+    uint64_t removed_handles[ticker->count + 1];
+    int removed_targets[ticker->count + 1];
+    int removed_count = 0;
+    for (int i = 0; i < ticker->count; i++) {
+        struct gradient_track* track = ticker->tracks[i];
+        if (track->handle == GRADIENT_TRACK_GLOBAL) continue;
+
+        struct border* border = windows_get(windows, track->handle);
+        if (!border || !border->setting_override.enabled) {
+            removed_handles[removed_count] = track->handle;
+            removed_targets[removed_count++] = track->target;
+        }
+    }
+    pthread_mutex_unlock(&ticker->mutex);
+
+    for (int i = 0; i < removed_count; i++) {
+        gradient_ticker_remove(ticker, removed_handles[i], removed_targets[i]);
+    }
+
+    gradient_animation_update_visibility(animator, anim_state, windows);
 }
 
 void gradient_animation_stop(struct animation* animator) {
-    if (animator && animator->link) { // Check if animation was actually started
-        animation_stop(animator); // This also frees animator->context if it was set by animation_start
-                                  // and if animation_stop is designed to do so.
-                                  // Our animator->context is &g_active_gradient_state, which is global,
-                                  // so animation_stop should NOT free it.
-                                  // Looking at animation.c, animation_stop frees animation->context.
-                                  // This is an issue if context is not heap-allocated.
-                                  // For now, we assume animation_stop is safe or we'll adjust.
-                                  // A safer animation_stop would be:
-                                  // if (animator->link) { CVDisplayLinkStop... CVDisplayLinkRelease... animator->link = NULL; }
-                                  // animator->context = NULL; (without freeing if it's not heap allocated by animation_start)
-        
-        // Since g_active_gradient_state is global, we don't free it here.
-        // We just ensure the CVDisplayLink is stopped.
-        // The current animation_stop in animation.c will free animator->context.
-        // This needs to be handled: either make g_active_gradient_state heap allocated
-        // or modify animation_stop. For now, we'll proceed and address if it crashes.
-        // A quick fix: animation_stop(animator) will set animator->context to NULL.
-        // We can rely on that.
+    if (animator && animator->subscribed) { // Check if animation was actually started
+        struct gradient_animation_state* anim_state = animator->context;
+        // animation_stop does not free the context, anim_state is global
+        animation_stop(animator);
+
+        if (anim_state) {
+            struct gradient_dispatch* dispatch = &anim_state->dispatch;
+            printf("[+] Borders: Gradient dispatch: %llu sent, %llu coalesced, %llu unchanged, max queue depth %d\n",
+                   (unsigned long long)atomic_load(&dispatch->dispatched),
+                   (unsigned long long)atomic_load(&dispatch->coalesced),
+                   (unsigned long long)atomic_load(&dispatch->unchanged),
+                   atomic_load(&dispatch->max_queue_depth)                );
+        }
         printf("[+] Borders: Gradient animation stopped.\n");
     }
 }
+
+void gradient_animation_print_stats(struct animation* animator,
+                                    struct gradient_animation_state* anim_state) {
+    struct gradient_dispatch* dispatch = &anim_state->dispatch;
+    printf("[+] Borders: Animation stats (%s, %.1f Hz, %llu frames)\n",
+           animator->subscribed ? "running" : "suspended",
+           animator->frame_time > 0 ? 1e6 / animator->frame_time : 0.0,
+           (unsigned long long)animation_ticker_frames()               );
+    printf("  %-18s %10llu dispatched  %llu coalesced  %llu unchanged"
+           "  max queue depth %d\n",
+           "main thread",
+           (unsigned long long)atomic_load(&dispatch->dispatched),
+           (unsigned long long)atomic_load(&dispatch->coalesced),
+           (unsigned long long)atomic_load(&dispatch->unchanged),
+           atomic_load(&dispatch->max_queue_depth)                 );
+    gradient_pacing_print(&anim_state->pacing, stdout);
+
+    uint64_t hits, misses, evictions;
+    gradient_cache_stats(&g_gradient_cache, &hits, &misses, &evictions);
+    printf("  %-18s %10llu hits  %llu misses  %llu evictions\n",
+           "gradient cache",
+           (unsigned long long)hits,
+           (unsigned long long)misses,
+           (unsigned long long)evictions);
+
+    uint64_t rebuilds, reuses;
+    border_plan_stats(&rebuilds, &reuses);
+    printf("  %-18s %10llu rebuilds  %llu reuses\n",
+           "draw plans",
+           (unsigned long long)rebuilds,
+           (unsigned long long)reuses  );
+    fflush(stdout);
+}
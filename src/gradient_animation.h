@@ -2,37 +2,45 @@
 
 #include "animation.h" // For struct animation
 #include "border.h"    // For struct settings
-#include <CoreVideo/CoreVideo.h> // For CVDisplayLinkRef, CVTimeStamp, CVOptionFlags, CVReturn, kCVReturnSuccess
+#include "gradient.h"
+#include <stdatomic.h>
 
-// State for the gradient animation
+struct windows;
+
+// State for the gradient animation: one subscription to the animation ticker
+// ticks the tracks of g_settings and of every border with its own animated
+// settings.
 struct gradient_animation_state {
-    int current_interpolation_step;
-    double time_accumulator_usec;    // Accumulates frame_time in microseconds
-    double step_duration_usec;       // Calculated duration of one interpolation step in microseconds
-
-    uint32_t current_tl_color;
-    uint32_t current_br_color;
-    uint32_t next_tl_color;
-    uint32_t next_br_color;
-
-    // Pointer to the color palette from g_settings
-    uint32_t* color_palette; // This will point to g_settings.parsed_gradient_colors
-    int num_palette_colors;
-    int palette_total_steps; // This will be g_settings.animated_gradient_steps
+    struct gradient_ticker ticker;
+    struct gradient_dispatch dispatch;
+    struct gradient_pacing pacing;
+    struct gradient_idle idle;
 };
 
-// Initializes the gradient animation state and starts the animation if enabled
-void gradient_animation_init_and_start(struct animation* animator,
-                                       struct gradient_animation_state* anim_state,
-                                       struct settings* settings);
-
-// The CVDisplayLink callback function for gradient animation
-CVReturn gradient_animation_callback(CVDisplayLinkRef displayLink,
-                                     const CVTimeStamp* now,
-                                     const CVTimeStamp* outputTime,
-                                     CVOptionFlags flagsIn,
-                                     CVOptionFlags* flagsOut,
-                                     void* displayLinkContext);
+void gradient_animation_init(struct gradient_animation_state* anim_state);
+
+// Creates, reconfigures and removes the tracks to match g_settings and the
+// overridden settings of the borders, and starts the display link when there
+// is anything to animate (stops it otherwise). Must run on the main thread.
+void gradient_animation_update(struct animation* animator,
+                               struct gradient_animation_state* anim_state,
+                               struct windows* windows);
+
+// Suspends the display link while no animated border is visible and resumes
+// it once one is. The tracks are positioned by the host clock, so they resume
+// in phase. Called on focus, hide/unhide and space events (main thread).
+void gradient_animation_update_visibility(struct animation* animator,
+                                          struct gradient_animation_state* anim_state,
+                                          struct windows* windows);
+
+// The animation ticker callback of the gradient animation, time is the host
+// time of the frame
+void gradient_animation_callback(struct animation* animation, uint64_t time);
+
+// Prints the frame pacing histograms and dispatch counters to stdout, on
+// request of borders --stats=animation (main thread)
+void gradient_animation_print_stats(struct animation* animator,
+                                    struct gradient_animation_state* anim_state);
 
 // Stops the gradient animation
 void gradient_animation_stop(struct animation* animator);
@@ -0,0 +1,141 @@
+#include "gradient_cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+static TABLE_HASH_FUNC(hash_gradient_key) {
+  struct gradient_cache_key* gradient_key = key;
+  uint64_t colors = ((uint64_t)gradient_key->color1 << 32)
+                    | gradient_key->color2;
+  colors ^= (uint64_t)gradient_key->space * 0x9e3779b97f4a7c15ull;
+  colors *= 0xff51afd7ed558ccdull;
+  return (unsigned long)(colors ^ (colors >> 32));
+}
+
+static TABLE_COMPARE_FUNC(cmp_gradient_key) {
+  struct gradient_cache_key* a = key_a;
+  struct gradient_cache_key* b = key_b;
+  return a->color1 == b->color1
+         && a->color2 == b->color2
+         && a->space == b->space;
+}
+
+static void gradient_cache_unlink(struct gradient_cache* cache, int index) {
+  struct gradient_cache_entry* entry = &cache->entries[index];
+  if (entry->prev >= 0) cache->entries[entry->prev].next = entry->next;
+  else cache->head = entry->next;
+  if (entry->next >= 0) cache->entries[entry->next].prev = entry->prev;
+  else cache->tail = entry->prev;
+}
+
+static void gradient_cache_push_front(struct gradient_cache* cache, int index) {
+  struct gradient_cache_entry* entry = &cache->entries[index];
+  entry->prev = -1;
+  entry->next = cache->head;
+  if (cache->head >= 0) cache->entries[cache->head].prev = index;
+  cache->head = index;
+  if (cache->tail < 0) cache->tail = index;
+}
+
+void gradient_cache_init(struct gradient_cache* cache, int capacity, gradient_cache_create_func* create, gradient_cache_refcount_func* retain, gradient_cache_refcount_func* release) {
+  memset(cache, 0, sizeof(struct gradient_cache));
+  pthread_mutex_init(&cache->mutex, NULL);
+  cache->create = create;
+  cache->retain = retain;
+  cache->release = release;
+  cache->capacity = capacity > 0 ? capacity : 1;
+  cache->entries = malloc(sizeof(struct gradient_cache_entry)
+                          * cache->capacity                  );
+  cache->head = -1;
+  cache->tail = -1;
+  table_init_pooled(&cache->index,
+                    2 * cache->capacity,
+                    hash_gradient_key,
+                    cmp_gradient_key    );
+}
+
+void gradient_cache_free(struct gradient_cache* cache) {
+  pthread_mutex_lock(&cache->mutex);
+  for (int i = 0; i < cache->count; i++) {
+    cache->release(cache->entries[i].object);
+  }
+  table_free(&cache->index);
+  free(cache->entries);
+  cache->entries = NULL;
+  cache->count = 0;
+  cache->head = -1;
+  cache->tail = -1;
+  pthread_mutex_unlock(&cache->mutex);
+  pthread_mutex_destroy(&cache->mutex);
+}
+
+// Looks the key up and moves its entry to the front, with the mutex held
+static void* gradient_cache_lookup(struct gradient_cache* cache, struct gradient_cache_key* key) {
+  struct gradient_cache_entry* entry = table_find(&cache->index, key);
+  if (!entry) return NULL;
+
+  int index = entry - cache->entries;
+  if (cache->head != index) {
+    gradient_cache_unlink(cache, index);
+    gradient_cache_push_front(cache, index);
+  }
+  cache->retain(entry->object);
+  return entry->object;
+}
+
+void* gradient_cache_get(struct gradient_cache* cache, uint32_t color1, uint32_t color2, int space) {
+  struct gradient_cache_key key = { .color1 = color1,
+                                    .color2 = color2,
+                                    .space = space   };
+
+  pthread_mutex_lock(&cache->mutex);
+  void* object = gradient_cache_lookup(cache, &key);
+  if (object) cache->hits++;
+  else cache->misses++;
+  pthread_mutex_unlock(&cache->mutex);
+  if (object) return object;
+
+  // The object is created without holding the mutex, so a slow creation
+  // does not stall the draws hitting the cache. Whoever inserts first wins.
+  void* created = cache->create(color1, color2, space);
+  if (!created) return NULL;
+
+  void* evicted = NULL;
+  pthread_mutex_lock(&cache->mutex);
+  object = gradient_cache_lookup(cache, &key);
+  if (!object) {
+    int index;
+    if (cache->count < cache->capacity) {
+      index = cache->count++;
+    } else {
+      index = cache->tail;
+      gradient_cache_unlink(cache, index);
+      table_remove(&cache->index, &cache->entries[index].key);
+      evicted = cache->entries[index].object;
+      cache->evictions++;
+    }
+
+    struct gradient_cache_entry* entry = &cache->entries[index];
+    entry->key = key;
+    entry->object = created;
+    gradient_cache_push_front(cache, index);
+    table_add(&cache->index, &entry->key, entry);
+
+    cache->retain(created);
+    object = created;
+    created = NULL;
+  }
+  pthread_mutex_unlock(&cache->mutex);
+
+  // A draw still holding the evicted object keeps it alive
+  if (evicted) cache->release(evicted);
+  if (created) cache->release(created);
+  return object;
+}
+
+void gradient_cache_stats(struct gradient_cache* cache, uint64_t* hits, uint64_t* misses, uint64_t* evictions) {
+  pthread_mutex_lock(&cache->mutex);
+  *hits = cache->hits;
+  *misses = cache->misses;
+  *evictions = cache->evictions;
+  pthread_mutex_unlock(&cache->mutex);
+}
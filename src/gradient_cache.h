@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "hashtable.h"
+
+// Gradient objects shared by all borders: borders drawing the same colors in
+// the same color space get the same object instead of creating their own on
+// every redraw. The least recently used object is evicted once the cache is
+// full. The cache does not know the object type, it only creates, retains and
+// releases objects through the callbacks it is initialised with.
+
+#define GRADIENT_CACHE_SRGB 0
+
+// An animated frame is shared by all borders redrawn with it and then ages
+// out, the capacity only needs to cover the distinct gradients of one frame
+#define GRADIENT_CACHE_CAPACITY 64
+
+#define GRADIENT_CACHE_CREATE(name) void* name(uint32_t color1, uint32_t color2, int space)
+#define GRADIENT_CACHE_REFCOUNT(name) void name(void* object)
+typedef GRADIENT_CACHE_CREATE(gradient_cache_create_func);
+typedef GRADIENT_CACHE_REFCOUNT(gradient_cache_refcount_func);
+
+struct gradient_cache_key {
+  uint32_t color1;
+  uint32_t color2;
+  int space;
+};
+
+struct gradient_cache_entry {
+  struct gradient_cache_key key;
+  void* object;               // The cache holds one reference
+  int prev;                   // Recency list, -1 terminated
+  int next;
+};
+
+struct gradient_cache {
+  pthread_mutex_t mutex;
+  gradient_cache_create_func* create;
+  gradient_cache_refcount_func* retain;
+  gradient_cache_refcount_func* release;
+
+  struct table index;         // Key to entry
+  struct gradient_cache_entry* entries;
+  int count;
+  int capacity;
+  int head;                   // Most recently used
+  int tail;                   // Least recently used
+
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+};
+
+void gradient_cache_init(struct gradient_cache* cache, int capacity, gradient_cache_create_func* create, gradient_cache_refcount_func* retain, gradient_cache_refcount_func* release);
+
+// Releases the references of the cache, objects still retained by a caller
+// stay valid until the caller releases them
+void gradient_cache_free(struct gradient_cache* cache);
+
+// Returns the object for the colors and color space, retained for the
+// caller, who releases it once done drawing with it. May be called from any
+// thread; NULL only if creating the object failed.
+void* gradient_cache_get(struct gradient_cache* cache, uint32_t color1, uint32_t color2, int space);
+
+void gradient_cache_stats(struct gradient_cache* cache, uint64_t* hits, uint64_t* misses, uint64_t* evictions);
@@ -10,16 +10,98 @@ void table_init(struct table* table, int capacity, table_hash_func hash, table_c
   table->cmp = cmp;
   table->buckets = malloc(sizeof(struct bucket*) * capacity);
   memset(table->buckets, 0, sizeof(struct bucket*) * capacity);
+
+  table->pooled = false;
+  table->heap_keys = 0;
+  table->slabs = NULL;
+  table->free_nodes = NULL;
+}
+
+void table_init_pooled(struct table* table, int capacity, table_hash_func hash, table_compare_func cmp) {
+  table_init(table, capacity, hash, cmp);
+  table->pooled = true;
+}
+
+static struct bucket* table_alloc_bucket(struct table* table, int key_size) {
+  if (!table->pooled) {
+    struct bucket* bucket = malloc(sizeof(struct bucket));
+    bucket->key = malloc(key_size);
+    return bucket;
+  }
+
+  if (!table->free_nodes) {
+    struct table_slab* slab = malloc(sizeof(struct table_slab));
+    slab->next = table->slabs;
+    table->slabs = slab;
+    for (int i = TABLE_SLAB_BUCKETS - 1; i >= 0; --i) {
+      slab->nodes[i].bucket.next = (struct bucket*)table->free_nodes;
+      table->free_nodes = slab->nodes + i;
+    }
+  }
+
+  struct table_node* node = table->free_nodes;
+  table->free_nodes = (struct table_node*)node->bucket.next;
+
+  if (key_size <= TABLE_INLINE_KEY_SIZE) node->bucket.key = node->key;
+  else {
+    node->bucket.key = malloc(key_size);
+    table->heap_keys++;
+  }
+  return &node->bucket;
+}
+
+static void table_release_bucket(struct table* table, struct bucket* bucket) {
+  if (!table->pooled) {
+    free(bucket->key);
+    free(bucket);
+    return;
+  }
+
+  struct table_node* node = (struct table_node*)bucket;
+  if (bucket->key != node->key) {
+    free(bucket->key);
+    table->heap_keys--;
+  }
+  bucket->next = (struct bucket*)table->free_nodes;
+  table->free_nodes = node;
+}
+
+static void table_release_slabs(struct table* table) {
+  // Only keys which did not fit into a node need to be visited one by one
+  if (table->heap_keys > 0) {
+    for (int i = 0; i < table->capacity; ++i) {
+      struct bucket* bucket = table->buckets[i];
+      while (bucket) {
+        if (bucket->key != ((struct table_node*)bucket)->key) {
+          free(bucket->key);
+        }
+        bucket = bucket->next;
+      }
+    }
+    table->heap_keys = 0;
+  }
+
+  struct table_slab* slab = table->slabs;
+  while (slab) {
+    struct table_slab* next = slab->next;
+    free(slab);
+    slab = next;
+  }
+  table->slabs = NULL;
+  table->free_nodes = NULL;
 }
 
 void table_free(struct table *table) {
-  for (int i = 0; i < table->capacity; ++i) {
-    struct bucket *next, *bucket = table->buckets[i];
-    while (bucket) {
-      next = bucket->next;
-      free(bucket->key);
-      free(bucket);
-      bucket = next;
+  if (table->pooled) table_release_slabs(table);
+  else {
+    for (int i = 0; i < table->capacity; ++i) {
+      struct bucket *next, *bucket = table->buckets[i];
+      while (bucket) {
+        next = bucket->next;
+        free(bucket->key);
+        free(bucket);
+        bucket = next;
+      }
     }
   }
 
@@ -30,6 +112,13 @@ void table_free(struct table *table) {
 }
 
 void table_clear(struct table* table) {
+  if (table->pooled && table->buckets) {
+    table_release_slabs(table);
+    memset(table->buckets, 0, sizeof(struct bucket*) * table->capacity);
+    table->count = 0;
+    return;
+  }
+
   table_hash_func* hash = table->hash;
   table_compare_func* cmp = table->cmp;
   uint32_t capacity = table->capacity;
@@ -54,22 +143,20 @@ void table_rehash(struct table *table) {
   struct bucket **old_buckets = table->buckets;
   int old_capacity = table->capacity;
 
-  table->count = 0;
   table->capacity = 2 * table->capacity;
   table->buckets = malloc(sizeof(struct bucket *) * table->capacity);
   memset(table->buckets, 0, sizeof(struct bucket *) * table->capacity);
 
+  // Relink the existing buckets into the new array instead of copying them
   for (int i = 0; i < old_capacity; ++i) {
     struct bucket *next_bucket, *old_bucket = old_buckets[i];
     while (old_bucket) {
-      struct bucket **new_bucket = table_get_bucket(table, old_bucket->key);
-      *new_bucket = malloc(sizeof(struct bucket));
-      (*new_bucket)->key = old_bucket->key;
-      (*new_bucket)->value = old_bucket->value;
-      (*new_bucket)->next = NULL;
-      ++table->count;
       next_bucket = old_bucket->next;
-      free(old_bucket);
+      struct bucket **new_bucket = table->buckets
+                                   + (table->hash(old_bucket->key)
+                                      % table->capacity);
+      old_bucket->next = *new_bucket;
+      *new_bucket = old_bucket;
       old_bucket = next_bucket;
     }
   }
@@ -84,8 +171,7 @@ void _table_add(struct table* table, void* key, int key_size, void* value) {
       (*bucket)->value = value;
     }
   } else {
-    *bucket = malloc(sizeof(struct bucket));
-    (*bucket)->key = malloc(key_size);
+    *bucket = table_alloc_bucket(table, key_size);
     (*bucket)->value = value;
     memcpy((*bucket)->key, key, key_size);
     (*bucket)->next = NULL;
@@ -101,9 +187,8 @@ void _table_add(struct table* table, void* key, int key_size, void* value) {
 void table_remove(struct table* table, void* key) {
   struct bucket *next, **bucket = table_get_bucket(table, key);
   if (*bucket) {
-    free((*bucket)->key);
     next = (*bucket)->next;
-    free(*bucket);
+    table_release_bucket(table, *bucket);
     *bucket = next;
     --table->count;
   }
@@ -113,3 +198,314 @@ void* table_find(struct table* table, void* key) {
   struct bucket* bucket = *table_get_bucket(table, key);
   return bucket ? bucket->value : NULL;
 }
+
+TABLE_HASH_FUNC(table_hash_string) {
+  // djb2 by Dan Bernstein
+  unsigned long hash = 5381;
+  char c;
+  while((c = *((char*)key++))) {
+    hash = ((hash << 5) + hash) + c;
+  }
+  return hash;
+}
+
+TABLE_COMPARE_FUNC(table_cmp_string) {
+  return strcmp((char*)key_a, (char*)key_b) == 0;
+}
+
+static uint32_t wid_array_home(struct wid_array* array, uint32_t key) {
+  // Fibonacci hashing: window ids are handed out sequentially, so the golden
+  // ratio multiplier spreads neighbouring ids across the whole table.
+  return (key * 2654435769u) >> array->shift;
+}
+
+static struct wid_array* wid_array_create(int capacity) {
+  uint32_t bits = 1;
+  while ((1 << bits) < capacity) bits++;
+
+  // calloc hands out fresh zero pages for large arrays, so growing does not
+  // stall on clearing the whole new array up front
+  struct wid_array* array = calloc(1, sizeof(struct wid_array)
+                                      + sizeof(struct wid_slot) * (1 << bits));
+  array->capacity = 1 << bits;
+  array->mask = array->capacity - 1;
+  array->shift = 32 - bits;
+  return array;
+}
+
+static EPOCH_FREE_FUNC(wid_array_destroy) {
+  free(ptr);
+}
+
+// Readers probe slots while the writer stores to them, so every access is a
+// relaxed atomic: the sequence counter orders them and rejects torn probes.
+static inline uint32_t wid_slot_key(struct wid_slot* slot) {
+  return atomic_load_explicit(&slot->key, memory_order_relaxed);
+}
+
+static inline void* wid_slot_value(struct wid_slot* slot) {
+  return (void*)atomic_load_explicit(&slot->value, memory_order_relaxed);
+}
+
+static inline void wid_slot_set_value(struct wid_slot* slot, void* value) {
+  atomic_store_explicit(&slot->value, (uintptr_t)value, memory_order_relaxed);
+}
+
+static inline void wid_slot_set(struct wid_slot* slot, uint32_t key, void* value) {
+  atomic_store_explicit(&slot->key, key, memory_order_relaxed);
+  wid_slot_set_value(slot, value);
+}
+
+static struct wid_slot* wid_array_get_slot(struct wid_array* array, uint32_t key) {
+  uint32_t i = wid_array_home(array, key);
+  while (wid_slot_key(array->slots + i)
+         && wid_slot_key(array->slots + i) != key) {
+    i = (i + 1) & array->mask;
+  }
+  return array->slots + i;
+}
+
+// Reader side probe: the slots might be rewritten concurrently, so the probe
+// length is bounded and the result is only trusted once the sequence check
+// in wid_table_find passed.
+static void* wid_array_lookup(struct wid_array* array, uint32_t key) {
+  uint32_t i = wid_array_home(array, key);
+  for (int n = 0; n < array->capacity; n++) {
+    uint32_t slot_key = wid_slot_key(array->slots + i);
+    if (!slot_key) return NULL;
+    if (slot_key == key) return wid_slot_value(array->slots + i);
+    i = (i + 1) & array->mask;
+  }
+  return NULL;
+}
+
+static void wid_array_remove(struct wid_array* array, struct wid_slot* slot) {
+  // Backward shift deletion: pull every following entry of the probe run
+  // into the hole unless it already sits in its home position range.
+  uint32_t i = slot - array->slots;
+  uint32_t j = i;
+  while (true) {
+    j = (j + 1) & array->mask;
+    uint32_t key = wid_slot_key(array->slots + j);
+    if (!key) break;
+
+    uint32_t home = wid_array_home(array, key);
+    if (((j - home) & array->mask) >= ((j - i) & array->mask)) {
+      wid_slot_set(array->slots + i, key, wid_slot_value(array->slots + j));
+      i = j;
+    }
+  }
+
+  wid_slot_set(array->slots + i, 0, NULL);
+}
+
+static void wid_table_write_begin(struct wid_table* table) {
+  unsigned sequence = atomic_load_explicit(&table->sequence,
+                                           memory_order_relaxed);
+  atomic_store_explicit(&table->sequence, sequence + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+static void wid_table_write_end(struct wid_table* table) {
+  unsigned sequence = atomic_load_explicit(&table->sequence,
+                                           memory_order_relaxed);
+  atomic_store_explicit(&table->sequence, sequence + 1, memory_order_release);
+}
+
+static void wid_table_retire_array(struct wid_table* table, struct wid_array* array) {
+  if (array) epoch_retire(&table->epoch, array, wid_array_destroy);
+}
+
+uint64_t wid_table_read_begin(struct wid_table* table) {
+  return epoch_enter(&table->epoch);
+}
+
+void wid_table_read_end(struct wid_table* table, uint64_t entered) {
+  epoch_exit(&table->epoch, entered);
+}
+
+void wid_table_retire_value(struct wid_table* table, void* value, epoch_free_func* free_func) {
+  epoch_retire(&table->epoch, value, free_func);
+
+  // The retire advanced past the epoch of the value if it could, collecting
+  // once more releases it right away when no read section is left, rather
+  // than holding it until the next retire
+  epoch_collect(&table->epoch);
+}
+
+void wid_table_init(struct wid_table* table, int capacity) {
+  table->count = 0;
+  table->max_load = 0.75f;
+  table->migrate_index = 0;
+  atomic_init(&table->current, wid_array_create(capacity));
+  atomic_init(&table->old, NULL);
+  atomic_init(&table->sequence, 0);
+  epoch_init(&table->epoch);
+  table->writer = pthread_self();
+}
+
+void wid_table_free(struct wid_table* table) {
+  wid_table_write_begin(table);
+  wid_table_retire_array(table, table->current);
+  wid_table_retire_array(table, table->old);
+  table->current = NULL;
+  table->old = NULL;
+  table->migrate_index = 0;
+  table->count = 0;
+  wid_table_write_end(table);
+
+  // Tearing down the table requires that no reader is left
+  epoch_free(&table->epoch);
+}
+
+void wid_table_clear(struct wid_table* table) {
+  if (!table->current) return;
+  wid_table_write_begin(table);
+  wid_table_retire_array(table, table->old);
+  table->old = NULL;
+  table->migrate_index = 0;
+
+  // Readers might still be probing the current array, so it is replaced
+  // rather than wiped in place
+  struct wid_array* current = table->current;
+  table->current = wid_array_create(current->capacity);
+  wid_table_retire_array(table, current);
+  table->count = 0;
+  wid_table_write_end(table);
+}
+
+// Slots of the old array are never shifted while a migration is running:
+// moved and removed entries keep their key with a NULL value, so probe runs
+// in the old array stay intact until it is released as a whole.
+static void wid_table_migrate_slot(struct wid_table* table, struct wid_slot* slot) {
+  void* value = wid_slot_value(slot);
+  if (!value) return;
+  uint32_t key = wid_slot_key(slot);
+  wid_slot_set(wid_array_get_slot(table->current, key), key, value);
+  wid_slot_set_value(slot, NULL);
+}
+
+static void wid_table_migrate(struct wid_table* table, int steps) {
+  struct wid_array* old = table->old;
+  if (!old) return;
+
+  while (steps-- > 0 && table->migrate_index < old->capacity) {
+    wid_table_migrate_slot(table, old->slots + table->migrate_index++);
+  }
+
+  if (table->migrate_index >= old->capacity) {
+    table->old = NULL;
+    table->migrate_index = 0;
+    wid_table_retire_array(table, old);
+  }
+}
+
+static void wid_table_grow(struct wid_table* table) {
+  // A previous migration must be finished before the arrays can rotate
+  if (table->old) wid_table_migrate(table, table->old->capacity);
+
+  struct wid_array* current = table->current;
+  table->migrate_index = 0;
+  table->old = current;
+  table->current = wid_array_create(2 * current->capacity);
+}
+
+void wid_table_add(struct wid_table* table, uint32_t key, void* value) {
+  if (!key) return;
+  wid_table_write_begin(table);
+  wid_table_migrate(table, WID_TABLE_MIGRATE_STEP);
+
+  if (table->old) {
+    wid_table_migrate_slot(table, wid_array_get_slot(table->old, key));
+  }
+
+  struct wid_slot* slot = wid_array_get_slot(table->current, key);
+  if (wid_slot_key(slot)) {
+    if (!wid_slot_value(slot)) wid_slot_set_value(slot, value);
+  } else {
+    wid_slot_set(slot, key, value);
+    ++table->count;
+
+    float load = (1.0f * table->count) / table->current->capacity;
+    if (load > table->max_load) {
+      wid_table_grow(table);
+    }
+  }
+  wid_table_write_end(table);
+}
+
+void wid_table_remove(struct wid_table* table, uint32_t key) {
+  if (!key) return;
+  wid_table_write_begin(table);
+  wid_table_migrate(table, WID_TABLE_MIGRATE_STEP);
+
+  struct wid_slot* slot = NULL;
+  if (table->old) slot = wid_array_get_slot(table->old, key);
+
+  if (slot && wid_slot_value(slot)) {
+    wid_slot_set_value(slot, NULL);
+    --table->count;
+  } else {
+    slot = wid_array_get_slot(table->current, key);
+    if (wid_slot_key(slot)) {
+      wid_array_remove(table->current, slot);
+      --table->count;
+    }
+  }
+  wid_table_write_end(table);
+}
+
+void* wid_table_find(struct wid_table* table, uint32_t key) {
+  if (!key) return NULL;
+
+  // The writer can not race with itself and skips the reader protocol
+  if (pthread_equal(pthread_self(), table->writer)) {
+    void* value = table->current ? wid_array_lookup(table->current, key)
+                                 : NULL;
+    if (!value && table->old) value = wid_array_lookup(table->old, key);
+    return value;
+  }
+
+  uint64_t epoch = epoch_enter(&table->epoch);
+
+  void* value;
+  unsigned sequence;
+  while (true) {
+    sequence = atomic_load_explicit(&table->sequence, memory_order_acquire);
+    if (sequence & 1) continue;
+
+    struct wid_array* current = atomic_load(&table->current);
+    struct wid_array* old = atomic_load(&table->old);
+    value = current ? wid_array_lookup(current, key) : NULL;
+    if (!value && old) value = wid_array_lookup(old, key);
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&table->sequence,
+                             memory_order_relaxed) == sequence) {
+      break;
+    }
+  }
+
+  epoch_exit(&table->epoch, epoch);
+  return value;
+}
+
+void* wid_table_iterate(struct wid_table* table, int* cursor, uint32_t* key) {
+  struct wid_array* current = table->current;
+  struct wid_array* old = table->old;
+  int old_capacity = old ? old->capacity : 0;
+
+  while (*cursor < current->capacity + old_capacity) {
+    struct wid_slot* slot = *cursor < current->capacity
+                            ? current->slots + *cursor
+                            : old->slots + (*cursor - current->capacity);
+    ++*cursor;
+
+    void* value = wid_slot_value(slot);
+    if (wid_slot_key(slot) && value) {
+      if (key) *key = wid_slot_key(slot);
+      return value;
+    }
+  }
+  return NULL;
+}
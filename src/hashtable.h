@@ -1,4 +1,9 @@
 #pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "epoch.h"
 
 #define TABLE_HASH_FUNC(name) unsigned long name(void* key)
 typedef TABLE_HASH_FUNC(table_hash_func);
@@ -6,12 +11,28 @@ typedef TABLE_HASH_FUNC(table_hash_func);
 #define TABLE_COMPARE_FUNC(name) int name(void* key_a, void* key_b)
 typedef TABLE_COMPARE_FUNC(table_compare_func);
 
+// Pooled tables carve their buckets out of fixed-size slabs and store keys
+// of up to TABLE_INLINE_KEY_SIZE bytes inside the bucket, so clearing or
+// freeing the table releases whole slabs instead of every entry.
+#define TABLE_INLINE_KEY_SIZE 32
+#define TABLE_SLAB_BUCKETS 64
+
 struct bucket
 {
   void* key;
   void* value;
   struct bucket* next;
 };
+struct table_node
+{
+  struct bucket bucket;
+  char key[TABLE_INLINE_KEY_SIZE];
+};
+struct table_slab
+{
+  struct table_slab* next;
+  struct table_node nodes[TABLE_SLAB_BUCKETS];
+};
 struct table
 {
   int count;
@@ -20,9 +41,15 @@ struct table
   table_hash_func* hash;
   table_compare_func* cmp;
   struct bucket** buckets;
+
+  bool pooled;
+  int heap_keys;
+  struct table_slab* slabs;
+  struct table_node* free_nodes;
 };
 
 void table_init(struct table* table, int capacity, table_hash_func hash, table_compare_func cmp);
+void table_init_pooled(struct table* table, int capacity, table_hash_func hash, table_compare_func cmp);
 void table_free(struct table* table);
 void table_clear(struct table* table);
 
@@ -30,3 +57,70 @@ void table_clear(struct table* table);
 void _table_add(struct table* table, void* key, int key_size, void* value);
 void table_remove(struct table* table, void* key);
 void* table_find(struct table* table, void* key);
+
+TABLE_HASH_FUNC(table_hash_string);
+TABLE_COMPARE_FUNC(table_cmp_string);
+
+// Open addressing table specialised for window ids. Keys and values are stored
+// inline, so find/add/remove never allocate. The window id 0 is reserved to
+// mark empty slots.
+//
+// wid_table_find may be called from any thread without locking: readers
+// load the slots atomically, validate their probe against a sequence counter,
+// and arrays are only freed once no reader can still see them. All other functions must be called from
+// the single writer thread, the one which initialised the table.
+#define WID_TABLE_MIGRATE_STEP 32
+
+struct wid_slot
+{
+  atomic_uint key;
+  atomic_uintptr_t value;
+};
+struct wid_array
+{
+  int capacity;
+  uint32_t mask;
+  uint32_t shift;
+  struct wid_slot slots[];
+};
+struct wid_table
+{
+  int count;
+  float max_load;
+  _Atomic(struct wid_array*) current;
+
+  // While growing, entries are moved from old to current a few slots at a
+  // time and lookups consult both arrays until the migration is done.
+  _Atomic(struct wid_array*) old;
+  int migrate_index;
+
+  atomic_uint sequence;
+  struct epoch epoch;
+  pthread_t writer;
+};
+
+void wid_table_init(struct wid_table* table, int capacity);
+void wid_table_free(struct wid_table* table);
+void wid_table_clear(struct wid_table* table);
+
+void wid_table_add(struct wid_table* table, uint32_t key, void* value);
+void wid_table_remove(struct wid_table* table, uint32_t key);
+void* wid_table_find(struct wid_table* table, uint32_t key);
+
+// The epoch only protects the arrays of the table, not the values stored in
+// them: a value found on a reader thread must not be dereferenced outside of
+// a read section, and the writer hands removed values to
+// wid_table_retire_value instead of freeing them, which releases them once
+// every read section that could have found them has ended.
+//
+//   uint64_t entered = wid_table_read_begin(table);
+//   struct value* value = wid_table_find(table, key);
+//   if (value) ...
+//   wid_table_read_end(table, entered);
+//
+// The writer thread never needs a read section for the values it retires
+// itself.
+uint64_t wid_table_read_begin(struct wid_table* table);
+void wid_table_read_end(struct wid_table* table, uint64_t entered);
+void wid_table_retire_value(struct wid_table* table, void* value, epoch_free_func* free_func);
+void* wid_table_iterate(struct wid_table* table, int* cursor, uint32_t* key);
@@ -0,0 +1,67 @@
+#include "histogram.h"
+
+void histogram_reset(struct histogram* histogram) {
+  atomic_store_explicit(&histogram->count, 0, memory_order_relaxed);
+  atomic_store_explicit(&histogram->sum, 0, memory_order_relaxed);
+  atomic_store_explicit(&histogram->max, 0, memory_order_relaxed);
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    atomic_store_explicit(&histogram->buckets[i], 0, memory_order_relaxed);
+  }
+}
+
+uint64_t histogram_bucket_low(int bucket) {
+  if (bucket < HISTOGRAM_LINEAR) return bucket;
+  int index = bucket - HISTOGRAM_LINEAR;
+  int exponent = (index >> HISTOGRAM_SUB_BITS) + 4;
+  uint64_t sub = index & ((1 << HISTOGRAM_SUB_BITS) - 1);
+  return (1ull << exponent) + (sub << (exponent - HISTOGRAM_SUB_BITS));
+}
+
+uint64_t histogram_percentile(struct histogram* histogram, double fraction) {
+  // The buckets are summed up instead of trusting count, which a concurrent
+  // record may already have moved past them
+  uint64_t counts[HISTOGRAM_BUCKETS];
+  uint64_t total = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    counts[i] = atomic_load_explicit(&histogram->buckets[i],
+                                     memory_order_relaxed   );
+    total += counts[i];
+  }
+  if (total == 0) return 0;
+
+  uint64_t rank = (uint64_t)(fraction * total + 0.5);
+  if (rank < 1) rank = 1;
+  if (rank > total) rank = total;
+
+  uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+  uint64_t seen = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    seen += counts[i];
+    if (seen < rank) continue;
+
+    uint64_t low = histogram_bucket_low(i);
+    uint64_t high = i + 1 < HISTOGRAM_BUCKETS
+                    ? histogram_bucket_low(i + 1) - 1
+                    : UINT64_MAX;
+    uint64_t value = low + (high - low) / 2;
+    return value < max ? value : max;
+  }
+  return max;
+}
+
+void histogram_print(struct histogram* histogram, FILE* file, const char* name, const char* unit, double scale) {
+  uint64_t count = atomic_load_explicit(&histogram->count,
+                                        memory_order_relaxed);
+  uint64_t sum = atomic_load_explicit(&histogram->sum, memory_order_relaxed);
+  uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+  fprintf(file, "  %-18s %10llu samples  mean %8.2f  p50 %8.2f  p90 %8.2f"
+                "  p99 %8.2f  max %8.2f %s\n",
+          name,
+          (unsigned long long)count,
+          count ? sum / scale / count : 0.0,
+          histogram_percentile(histogram, 0.50) / scale,
+          histogram_percentile(histogram, 0.90) / scale,
+          histogram_percentile(histogram, 0.99) / scale,
+          max / scale,
+          unit                                           );
+}
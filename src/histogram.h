@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+// Lock-free histogram of unsigned samples with log-linear buckets: values
+// below 16 have a bucket of their own, above that every power of two is split
+// into 8 buckets, which bounds the relative error of a percentile by 1/8.
+// Any thread may record while another one reads or resets, a read during a
+// record may miss that single sample.
+
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_LINEAR   16
+#define HISTOGRAM_BUCKETS  (HISTOGRAM_LINEAR \
+                            + (64 - 4) * (1 << HISTOGRAM_SUB_BITS))
+
+struct histogram {
+  atomic_uint_fast64_t count;
+  atomic_uint_fast64_t sum;
+  atomic_uint_fast64_t max;
+  atomic_uint_fast64_t buckets[HISTOGRAM_BUCKETS];
+};
+
+void histogram_reset(struct histogram* histogram);
+
+// Smallest value falling into the bucket
+uint64_t histogram_bucket_low(int bucket);
+
+static inline int histogram_bucket(uint64_t value) {
+  if (value < HISTOGRAM_LINEAR) return (int)value;
+  int exponent = 63 - __builtin_clzll(value);
+  int sub = (value >> (exponent - HISTOGRAM_SUB_BITS))
+            & ((1 << HISTOGRAM_SUB_BITS) - 1);
+  return HISTOGRAM_LINEAR + ((exponent - 4) << HISTOGRAM_SUB_BITS) + sub;
+}
+
+static inline void histogram_record(struct histogram* histogram, uint64_t value) {
+  atomic_fetch_add_explicit(&histogram->buckets[histogram_bucket(value)],
+                            1,
+                            memory_order_relaxed                        );
+  atomic_fetch_add_explicit(&histogram->sum, value, memory_order_relaxed);
+  uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+  while (value > max
+         && !atomic_compare_exchange_weak_explicit(&histogram->max,
+                                                   &max,
+                                                   value,
+                                                   memory_order_relaxed,
+                                                   memory_order_relaxed));
+  atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+}
+
+// Value below which the fraction (in [0, 1]) of the samples lies, reported as
+// the middle of its bucket and never above the largest sample
+uint64_t histogram_percentile(struct histogram* histogram, double fraction);
+
+// Prints one line with the sample count, mean, median, p90, p99 and maximum,
+// the values divided by scale
+void histogram_print(struct histogram* histogram, FILE* file, const char* name, const char* unit, double scale);
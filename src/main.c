@@ -24,8 +24,9 @@
 
 pid_t g_pid;
 mach_port_t g_server_port;
-struct table g_windows;
+struct windows g_windows;
 struct mach_server g_mach_server;
+struct gradient_cache g_gradient_cache;
 
 // --- Added for Gradient Animation ---
 struct animation g_gradient_animator;
@@ -50,10 +51,20 @@ struct settings g_settings = { .enabled = true,
                                .whitelist_enabled = false,
                                // --- Added for Gradient Animation ---
                                .animated_gradient_enabled = false,
-                               .parsed_gradient_colors = NULL,
-                               .num_parsed_gradient_colors = 0,
+                               .animated_gradient_palette = NULL,
                                .animated_gradient_steps = 50,
-                               .animated_gradient_duration_sec = 20.0f
+                               .animated_gradient_duration_sec = 20.0f,
+                               .animated_gradient_space = GRADIENT_SPACE_SRGB,
+                               .animated_gradient_speed = 1.0f,
+                               .animated_gradient_phase = 0.0f,
+                               .animated_gradient_order = GRADIENT_ORDER_RANDOM,
+                               .animated_gradient_seed = 0,
+                               .animated_gradient_inactive = false,
+                               .animated_gradient_inactive_rate = 10.0f,
+                               .animated_gradient_angled = false,
+                               .animated_gradient_angle = 135.0f,
+                               .animated_gradient_rotation = 0.0f,
+                               .animated_gradient_easing = { .type = EASING_LINEAR }
                                // --- End Added for Gradient Animation ---
                                };
 
@@ -61,83 +72,74 @@ struct settings g_settings = { .enabled = true,
 static void cleanup_gradient_animation(void) {
     // This function will be called upon normal program termination
     gradient_animation_stop(&g_gradient_animator);
+    gradient_ticker_free(&g_gradient_anim_state.ticker);
     
-    // Free the parsed_gradient_colors if it was allocated
-    if (g_settings.parsed_gradient_colors) {
-        free(g_settings.parsed_gradient_colors);
-        g_settings.parsed_gradient_colors = NULL;
-        g_settings.num_parsed_gradient_colors = 0;
-    }
+    // Release the palette if one was parsed
+    gradient_palette_release(g_settings.animated_gradient_palette);
+    g_settings.animated_gradient_palette = NULL;
 }
 // --- End Added for Gradient Animation ---
 
-static TABLE_HASH_FUNC(hash_windows) {
-  return *(uint32_t *) key;
-}
-
-static TABLE_COMPARE_FUNC(cmp_windows) {
-  return *(uint32_t *) key_a == *(uint32_t *) key_b;
-}
-
-static TABLE_HASH_FUNC(hash_blacklist) {
-  // djb2 by Dan Bernstein
-  unsigned long hash = 5381;
-  char c;
-  while((c = *((char*)key++))) {
-    hash = ((hash << 5) + hash) + c;
-  }
-  return hash;
-}
-
-static TABLE_COMPARE_FUNC(cmp_blacklist) {
-  return strcmp((char*)key_a, (char*)key_b) == 0;
-}
-
 static void message_handler(void* data, uint32_t len) {
   char* message = data;
   uint32_t update_mask = 0;
   struct settings settings = g_settings;
+  // The copy owns a reference to the palette it shares with g_settings, the
+  // parser releases it when the message replaces the palette
+  gradient_palette_retain(settings.animated_gradient_palette);
 
   while(message && *message) {
     update_mask |= parse_settings(&settings, 1, &message);
     message += strlen(message) + 1;
   }
 
+  // The statistics are printed by the running instance, to its stdout
+  if (update_mask & BORDER_UPDATE_MASK_STATS) {
+    gradient_animation_print_stats(&g_gradient_animator,
+                                   &g_gradient_anim_state);
+    update_mask &= ~BORDER_UPDATE_MASK_STATS;
+    if (!update_mask) {
+      gradient_palette_release(settings.animated_gradient_palette);
+      return;
+    }
+  }
+
   if (settings.apply_to > 0) {
-    struct border* border = table_find(&g_windows, &settings.apply_to);
+    struct border* border = windows_find(&g_windows, settings.apply_to);
     if (border) {
+      gradient_palette_release(border->setting_override.animated_gradient_palette);
       border->setting_override = settings;
       border->setting_override.enabled = true;
       border->needs_redraw = true;
       border_update(border, true);
+      gradient_animation_update(&g_gradient_animator,
+                                &g_gradient_anim_state,
+                                &g_windows             );
+    } else {
+      gradient_palette_release(settings.animated_gradient_palette);
     }
     return;
   } else {
+    gradient_palette_release(g_settings.animated_gradient_palette);
     g_settings = settings;
-    for (int i = 0; i < g_windows.capacity; ++i) {
-      struct bucket* bucket = g_windows.buckets[i];
-      while (bucket) {
-        if (bucket->value) {
-          struct border* border = bucket->value;
-          if (border->setting_override.enabled) {
-            char* message = data;
-            uint32_t window_update_mask = 0;
-            while(message && *message) {
-              window_update_mask |= parse_settings(&border->setting_override,
-                                                   1,
-                                                   &message                  );
-              message += strlen(message) + 1;
-            }
-
-            if (window_update_mask
-                && !((update_mask & BORDER_UPDATE_MASK_ALL)
-                     || (update_mask & BORDER_UPDATE_MASK_RECREATE_ALL))) {
-              border->needs_redraw = true;
-              border_update(border, true);
-            }
-          }
+    for (int i = 0; i < g_windows.borders.count; ++i) {
+      struct border* border = g_windows.borders.values[i];
+      if (border->setting_override.enabled) {
+        char* message = data;
+        uint32_t window_update_mask = 0;
+        while(message && *message) {
+          window_update_mask |= parse_settings(&border->setting_override,
+                                               1,
+                                               &message                  );
+          message += strlen(message) + 1;
+        }
+
+        if (window_update_mask
+            && !((update_mask & BORDER_UPDATE_MASK_ALL)
+                 || (update_mask & BORDER_UPDATE_MASK_RECREATE_ALL))) {
+          border->needs_redraw = true;
+          border_update(border, true);
         }
-        bucket = bucket->next;
       }
     }
   }
@@ -151,6 +153,10 @@ static void message_handler(void* data, uint32_t len) {
   } else if (update_mask & BORDER_UPDATE_MASK_INACTIVE) {
     windows_update_inactive(&g_windows);
   }
+
+  gradient_animation_update(&g_gradient_animator,
+                            &g_gradient_anim_state,
+                            &g_windows             );
 }
 
 static void send_args_to_server(mach_port_t port, int argc, char** argv) {
@@ -198,12 +204,16 @@ int main(int argc, char** argv) {
     exit(EXIT_SUCCESS);
   }
 
-  table_init(&g_settings.blacklist, 64, hash_blacklist, cmp_blacklist);
-  table_init(&g_settings.whitelist, 64, hash_blacklist, cmp_blacklist);
+  table_init_pooled(&g_settings.blacklist, 64, table_hash_string, table_cmp_string);
+  table_init_pooled(&g_settings.whitelist, 64, table_hash_string, table_cmp_string);
   g_settings.ax_focus = ax_check_trust(true);
 
   uint32_t update_mask = parse_settings(&g_settings, argc - 1, argv + 1);
   mach_port_t server_port = mach_get_bs_port(BS_NAME);
+  if (!server_port && (update_mask & BORDER_UPDATE_MASK_STATS)) {
+    error("No borders instance is running to report statistics.\n");
+  }
+
   if (server_port && update_mask) {
     send_args_to_server(server_port, argc, argv);
     return 0;
@@ -214,7 +224,13 @@ int main(int argc, char** argv) {
   }
 
   pid_for_task(mach_task_self(), &g_pid);
-  table_init(&g_windows, 1024, hash_windows, cmp_windows);
+  windows_init(&g_windows);
+  gradient_cache_init(&g_gradient_cache,
+                      GRADIENT_CACHE_CAPACITY,
+                      drawing_cache_create_gradient,
+                      drawing_cache_retain_gradient,
+                      drawing_cache_release_gradient);
+  gradient_animation_init(&g_gradient_anim_state);
 
   g_server_port = create_connection_server_port();
 
@@ -251,7 +267,9 @@ int main(int argc, char** argv) {
 
   // Start gradient animation if enabled in settings
   // This is after all settings are loaded (command line + config file)
-  gradient_animation_init_and_start(&g_gradient_animator, &g_gradient_anim_state, &g_settings);
+  gradient_animation_update(&g_gradient_animator,
+                            &g_gradient_anim_state,
+                            &g_windows             );
   // --- End Added for Gradient Animation ---
 
   #ifdef _YABAI_INTEGRATION
@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+
+struct gradient {
+  enum { TL_TO_BR, TR_TO_BL, ANGLE } direction;
+  uint32_t color1;
+  uint32_t color2;
+  uint32_t angle;     // In ANGLE_STEPS, for the ANGLE direction
+};
+
+// Interpolates a single color channel (0-255)
+static inline uint8_t interpolate_channel(uint8_t c1, uint8_t c2, int step, int max_steps) {
+    if (step <= 0) return c1;
+    if (step >= max_steps) return c2;
+    // Linear interpolation: c1 + (c2 - c1) * step / max_steps
+    // Add 0.5 for rounding before truncation by int cast
+    return (uint8_t)(c1 + (double)(c2 - c1) * step / max_steps + 0.5);
+}
+
+// Interpolates an ARGB color value (0xAARRGGBB)
+// Alpha is taken from color_from, or set to 0xFF if color_from's alpha is 0.
+static inline uint32_t interpolate_color_value(uint32_t color_from, uint32_t color_to, int step, int max_steps) {
+    uint8_t a1 = (color_from >> 24) & 0xFF;
+    uint8_t r1 = (color_from >> 16) & 0xFF;
+    uint8_t g1 = (color_from >> 8) & 0xFF;
+    uint8_t b1 = (color_from >> 0) & 0xFF;
+
+    // uint8_t a2 = (color_to >> 24) & 0xFF; // Alpha of target color, usually we want to keep source alpha or FF
+    uint8_t r2 = (color_to >> 16) & 0xFF;
+    uint8_t g2 = (color_to >> 8) & 0xFF;
+    uint8_t b2 = (color_to >> 0) & 0xFF;
+
+    uint8_t final_a = (a1 == 0) ? 0xFF : a1; // Use source alpha, or FF if source alpha is transparent
+    uint8_t final_r = interpolate_channel(r1, r2, step, max_steps);
+    uint8_t final_g = interpolate_channel(g1, g2, step, max_steps);
+    uint8_t final_b = interpolate_channel(b1, b2, step, max_steps);
+
+    return (final_a << 24) | (final_r << 16) | (final_g << 8) | final_b;
+}
+
+// Fills out[0...max_steps] with the colors interpolate_color_value yields for
+// each step of the transition from color_from to color_to.
+static inline void interpolate_color_table(uint32_t color_from, uint32_t color_to, int max_steps, uint32_t* out) {
+    for (int step = 0; step <= max_steps; step++) {
+        out[step] = interpolate_color_value(color_from, color_to, step, max_steps);
+    }
+}
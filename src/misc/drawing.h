@@ -1,11 +1,8 @@
 #pragma once
 #include <CoreGraphics/CoreGraphics.h>
-
-struct gradient {
-  enum { TL_TO_BR, TR_TO_BL } direction;
-  uint32_t color1;
-  uint32_t color2;
-};
+#include "color.h"
+#include "../angle.h"
+#include "../gradient_cache.h"
 
 static inline void colors_from_hex(uint32_t hex, float* a, float* r, float* g, float* b) {
   *a = ((hex >> 24) & 0xff) / 255.f;
@@ -39,52 +36,46 @@ static inline void drawing_set_stroke_and_fill(CGContextRef context, uint32_t co
   }
 }
 
-static inline void drawing_clip_between_rect_and_path(CGContextRef context, CGRect frame, CGPathRef path) {
+// Even-odd path of the area between the frame and the path inside it
+static inline CGPathRef drawing_create_path_between_rect_and_path(CGRect frame, CGPathRef path) {
   CGMutablePathRef clip_path = CGPathCreateMutable();
   CGPathAddRect(clip_path, NULL, frame);
   CGPathAddPath(clip_path, NULL, path);
-  CGContextAddPath(context, clip_path);
-  CGContextEOClip(context);
-  CFRelease(clip_path);
+  return clip_path;
 }
 
-static inline void drawing_add_rect_with_inset(CGContextRef context, CGRect rect, float inset) {
-  CGRect square_rect = CGRectInset(rect, inset, inset);
-  CGPathRef square_path = CGPathCreateWithRect(square_rect, NULL);
-  CGContextAddPath(context, square_path);
-  CFRelease(square_path);
+static inline CGPathRef drawing_create_rect_with_inset(CGRect rect, float inset) {
+  return CGPathCreateWithRect(CGRectInset(rect, inset, inset), NULL);
 }
 
-static inline void drawing_add_rounded_rect(CGContextRef context, CGRect rect, float border_radius) {
-  CGPathRef stroke_path = CGPathCreateWithRoundedRect(rect,
-                                                      border_radius,
-                                                      border_radius,
-                                                      NULL          );
-
-  CGContextAddPath(context, stroke_path);
-  CFRelease(stroke_path);
+static inline CGPathRef drawing_create_rounded_rect(CGRect rect, float border_radius) {
+  return CGPathCreateWithRoundedRect(rect, border_radius, border_radius, NULL);
 }
 
-static inline void drawing_draw_square_with_inset(CGContextRef context, CGRect rect, float inset) {
-  drawing_add_rect_with_inset(context, rect, inset);
-  CGContextFillPath(context);
+// The area the stroke of the path covers, with the default line cap, join
+// and miter limit of a context
+static inline CGPathRef drawing_create_stroked_path(CGPathRef path, float width) {
+  return CGPathCreateCopyByStrokingPath(path,
+                                        NULL,
+                                        width,
+                                        kCGLineCapButt,
+                                        kCGLineJoinMiter,
+                                        10.f             );
 }
 
-static inline void drawing_draw_square_gradient_with_inset(CGContextRef context,CGGradientRef gradient, CGPoint dir[2], CGRect rect, float inset) {
-  drawing_add_rect_with_inset(context, rect, inset);
-  CGContextClip(context);
-  CGContextDrawLinearGradient(context, gradient, dir[0], dir[1], 0);
+static inline void drawing_clip_even_odd(CGContextRef context, CGPathRef path) {
+  CGContextAddPath(context, path);
+  CGContextEOClip(context);
 }
 
-static inline void drawing_draw_rounded_rect_with_inset(CGContextRef context, CGRect rect, float border_radius, bool fill) {
-  drawing_add_rounded_rect(context, rect, border_radius);
+static inline void drawing_draw_path(CGContextRef context, CGPathRef path, bool fill) {
+  CGContextAddPath(context, path);
   if (fill) CGContextFillPath(context);
   else CGContextStrokePath(context);
 }
 
-static inline void drawing_draw_rounded_gradient_with_inset(CGContextRef context,CGGradientRef gradient, CGPoint dir[2], CGRect rect, float border_radius) {
-  drawing_add_rounded_rect(context, rect, border_radius);
-  CGContextReplacePathWithStrokedPath(context);
+static inline void drawing_draw_gradient_in_path(CGContextRef context, CGGradientRef gradient, CGPoint dir[2], CGPathRef path) {
+  CGContextAddPath(context, path);
   CGContextClip(context);
   CGContextDrawLinearGradient(context, gradient, dir[0], dir[1], 0);
 }
@@ -96,7 +87,7 @@ static inline void drawing_draw_filled_path(CGContextRef context, CGPathRef path
   CGContextFillPath(context);
 }
 
-static inline CGGradientRef drawing_create_gradient(struct gradient* gradient, CGAffineTransform trans, CGPoint direction[2]) {
+static inline CGGradientRef drawing_create_gradient(struct gradient* gradient) {
   float a1, a2, r1, r2, g1, g2, b1, b2;
   colors_from_hex(gradient->color1, &a1, &r1, &g1, &b1);
   colors_from_hex(gradient->color2, &a2, &r2, &g2, &b2);
@@ -110,15 +101,47 @@ static inline CGGradientRef drawing_create_gradient(struct gradient* gradient, C
   CFRelease(cfc);
   CGColorRelease(c[0]);
   CGColorRelease(c[1]);
+  return result;
+}
+
+// Callbacks of the shared gradient cache, all gradients are sRGB so far
+static inline GRADIENT_CACHE_CREATE(drawing_cache_create_gradient) {
+  struct gradient gradient = { .color1 = color1, .color2 = color2 };
+  return (void*)drawing_create_gradient(&gradient);
+}
+
+static inline GRADIENT_CACHE_REFCOUNT(drawing_cache_retain_gradient) {
+  CGGradientRetain(object);
+}
+
+static inline GRADIENT_CACHE_REFCOUNT(drawing_cache_release_gradient) {
+  CGGradientRelease(object);
+}
+
+// The endpoints only depend on the direction and the frame size, a change of
+// the angle alone does not need a new CGGradientRef
+static inline void drawing_gradient_direction(struct gradient* gradient, CGSize size, CGPoint direction[2]) {
+  if (gradient->direction == ANGLE) {
+    double start[2], end[2];
+    angle_line_endpoints(gradient->angle,
+                         size.width,
+                         size.height,
+                         start,
+                         end             );
+    direction[0] = CGPointMake(start[0], start[1]);
+    direction[1] = CGPointMake(end[0], end[1]);
+    return;
+  }
+
   if (gradient->direction == TR_TO_BL) {
     direction[0] = CGPointMake(1, 1);
     direction[1] = CGPointZero;
-  } else if (gradient->direction == TL_TO_BR) {
+  } else {
     direction[0] = CGPointMake(0, 1);
     direction[1] = CGPointMake(1, 0);
   }
+  CGAffineTransform trans = CGAffineTransformMakeScale(size.width,
+                                                       size.height);
   direction[0] = CGPointApplyAffineTransform(direction[0], trans);
   direction[1] = CGPointApplyAffineTransform(direction[1], trans);
-  return result;
 }
-
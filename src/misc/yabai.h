@@ -5,7 +5,6 @@
 #include "extern.h"
 #include "../windows.h"
 #include "../mach.h"
-#include <CoreVideo/CoreVideo.h>
 #include <pthread.h>
 
 // Additional border interfaces needed for the yabai integration
@@ -29,17 +28,15 @@ struct yabai_proxy_payload {
   uint32_t external_proxy_wid;
 };
 
-static CVReturn track_transform(CVDisplayLinkRef display_link, const CVTimeStamp* now, const CVTimeStamp* output_time, CVOptionFlags flags, CVOptionFlags* flags_out, void* context) {
-  struct animation* animation = context;
-  usleep(0.25*animation->frame_time);
-
+// Runs a quarter frame late on the shared animation ticker (animation->delay)
+static void track_transform(struct animation* animation, uint64_t time) {
   struct track_transform_payload* payload = animation->context;
   CGAffineTransform target_transform, border_transform;
   CGError error = SLSGetWindowTransform(payload->cid,
                                         payload->target_wid,
                                         &target_transform   );
 
-  if (error != kCGErrorSuccess) return kCVReturnSuccess;
+  if (error != kCGErrorSuccess) return;
 
   border_transform = CGAffineTransformConcat(target_transform,
                                              payload->initial_transform);
@@ -51,7 +48,6 @@ static CVReturn track_transform(CVDisplayLinkRef display_link, const CVTimeStamp
     SLSTransactionCommit(transaction, 0);
     CFRelease(transaction);
   }
-  return kCVReturnSuccess;
 }
 
 static void* yabai_proxy_begin_proc(void* context) {
@@ -80,7 +76,11 @@ static void* yabai_proxy_begin_proc(void* context) {
   payload->initial_transform.ty = 0.5*(proxy->frame.size.height
                                  - proxy->target_bounds.size.height);
 
+  // Once stopped the previous payload is no longer read by the ticker
+  struct track_transform_payload* previous = proxy->animation.context;
   animation_stop(&proxy->animation);
+  free(previous);
+  proxy->animation.delay = 0.25f;
   animation_start(&proxy->animation, track_transform, payload);
 
   if (!proxy->is_proxy) {
@@ -120,9 +120,11 @@ static void* yabai_proxy_end_proc(void* context) {
   return NULL;
 }
 
-static inline void yabai_proxy_begin(struct table* windows, uint32_t wid, uint32_t real_wid) {
+// The proxy messages arrive on the main run loop, the writer of the window
+// table, so the borders found here can not be retired while in use
+static inline void yabai_proxy_begin(struct windows* windows, uint32_t wid, uint32_t real_wid) {
   if (!real_wid || !wid) return;
-  struct border* border = table_find(windows, &real_wid);
+  struct border* border = windows_find(windows, real_wid);
 
   if (border) {
     pthread_mutex_lock(&border->mutex);
@@ -155,9 +157,9 @@ static inline void yabai_proxy_begin(struct table* windows, uint32_t wid, uint32
   }
 }
 
-static inline void yabai_proxy_end(struct table* windows, uint32_t wid, uint32_t real_wid) {
+static inline void yabai_proxy_end(struct windows* windows, uint32_t wid, uint32_t real_wid) {
   if (!real_wid || !wid) return;
-  struct border* border = (struct border*)table_find(windows, &real_wid);
+  struct border* border = (struct border*)windows_find(windows, real_wid);
   if (border) pthread_mutex_lock(&border->mutex);
   if (border && border->proxy && border->external_proxy_wid == wid) {
     struct border* proxy = border->proxy;
@@ -171,7 +173,9 @@ static inline void yabai_proxy_end(struct table* windows, uint32_t wid, uint32_t
       CFRelease(transaction);
     }
 
+    struct track_transform_payload* transform = proxy->animation.context;
     animation_stop(&proxy->animation);
+    free(transform);
     border_destroy(proxy);
 
     struct yabai_proxy_payload* payload
@@ -219,7 +223,7 @@ static void yabai_message(CFMachPortRef port, void* data, CFIndex size, void* co
   }
 }
 
-static inline void yabai_register_mach_port(struct table* windows) {
+static inline void yabai_register_mach_port(struct windows* windows) {
   ipc_space_t task = mach_task_self();
   mach_port_t port;
   if (mach_port_allocate(task,
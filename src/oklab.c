@@ -0,0 +1,131 @@
+#include "oklab.h"
+#include <math.h>
+#include <pthread.h>
+
+// Resolution of the linear -> sRGB table, fine enough that the 8 bit result
+// never differs by more than one level from the exact transfer function
+#define OKLAB_LINEAR_STEPS 4096
+// The cube root table covers [1/8, 1] and is interpolated linearly between
+// entries, smaller values are scaled into that range first
+#define OKLAB_CBRT_STEPS 1024
+#define OKLAB_CBRT_MIN 0.125f
+
+static float g_srgb_to_linear[256];
+static uint8_t g_linear_to_srgb[OKLAB_LINEAR_STEPS + 1];
+static float g_cbrt[OKLAB_CBRT_STEPS + 2];
+static pthread_once_t g_tables_once = PTHREAD_ONCE_INIT;
+
+static void oklab_init_tables() {
+  for (int i = 0; i < 256; i++) {
+    double c = i / 255.0;
+    g_srgb_to_linear[i] = c <= 0.04045 ? c / 12.92
+                                       : pow((c + 0.055) / 1.055, 2.4);
+  }
+
+  for (int i = 0; i <= OKLAB_LINEAR_STEPS; i++) {
+    double c = (double)i / OKLAB_LINEAR_STEPS;
+    double srgb = c <= 0.0031308 ? c * 12.92
+                                 : 1.055 * pow(c, 1.0 / 2.4) - 0.055;
+    g_linear_to_srgb[i] = (uint8_t)(srgb * 255.0 + 0.5);
+  }
+
+  // One entry past the end so the interpolation can read i + 1 at x = 1
+  for (int i = 0; i <= OKLAB_CBRT_STEPS + 1; i++) {
+    g_cbrt[i] = cbrt(OKLAB_CBRT_MIN
+                     + (1.0 - OKLAB_CBRT_MIN) * i / OKLAB_CBRT_STEPS);
+  }
+}
+
+static inline void oklab_ensure_tables() {
+  pthread_once(&g_tables_once, oklab_init_tables);
+}
+
+static inline float oklab_cbrt(float x) {
+  if (x <= 1e-9f) return 0.f;
+  if (x > 1.f) return cbrtf(x);
+
+  // cbrt(x) = cbrt(8x) / 2
+  float scale = 1.f;
+  while (x < OKLAB_CBRT_MIN) {
+    x *= 8.f;
+    scale *= 0.5f;
+  }
+
+  float position = (x - OKLAB_CBRT_MIN) * (OKLAB_CBRT_STEPS
+                                           / (1.f - OKLAB_CBRT_MIN));
+  int i = (int)position;
+  float fraction = position - i;
+  return scale * (g_cbrt[i] + (g_cbrt[i + 1] - g_cbrt[i]) * fraction);
+}
+
+static inline uint32_t oklab_linear_to_srgb(float c) {
+  if (c <= 0.f) return 0;
+  if (c >= 1.f) return 0xff;
+  return g_linear_to_srgb[(int)(c * OKLAB_LINEAR_STEPS + 0.5f)];
+}
+
+static struct oklab oklab_from_color_unchecked(uint32_t color) {
+  float r = g_srgb_to_linear[(color >> 16) & 0xff];
+  float g = g_srgb_to_linear[(color >> 8) & 0xff];
+  float b = g_srgb_to_linear[color & 0xff];
+
+  float l = oklab_cbrt(0.4122214708f * r + 0.5363325363f * g + 0.0514459929f * b);
+  float m = oklab_cbrt(0.2119034982f * r + 0.6806995451f * g + 0.1073969566f * b);
+  float s = oklab_cbrt(0.0883024619f * r + 0.2817188376f * g + 0.6299787005f * b);
+
+  return (struct oklab){
+    .l = 0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+    .a = 1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+    .b = 0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s
+  };
+}
+
+static uint32_t oklab_to_color_unchecked(struct oklab lab, uint32_t alpha) {
+  float l = lab.l + 0.3963377774f * lab.a + 0.2158037573f * lab.b;
+  float m = lab.l - 0.1055613458f * lab.a - 0.0638541728f * lab.b;
+  float s = lab.l - 0.0894841775f * lab.a - 1.2914855480f * lab.b;
+  l = l * l * l;
+  m = m * m * m;
+  s = s * s * s;
+
+  float r = 4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s;
+  float g = -1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s;
+  float b = -0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s;
+
+  return (alpha << 24) | (oklab_linear_to_srgb(r) << 16)
+                       | (oklab_linear_to_srgb(g) << 8)
+                       | oklab_linear_to_srgb(b);
+}
+
+struct oklab oklab_from_color(uint32_t color) {
+  oklab_ensure_tables();
+  return oklab_from_color_unchecked(color);
+}
+
+uint32_t oklab_to_color(struct oklab lab, uint32_t alpha) {
+  oklab_ensure_tables();
+  return oklab_to_color_unchecked(lab, alpha & 0xff);
+}
+
+void oklab_color_steps(uint32_t from, uint32_t to, uint32_t* out, int max_steps) {
+  oklab_ensure_tables();
+  uint32_t alpha = from >> 24;
+  if (!alpha) alpha = 0xff;
+
+  out[0] = (alpha << 24) | (from & 0x00ffffff);
+  if (max_steps <= 0) return;
+
+  struct oklab lab_from = oklab_from_color_unchecked(from);
+  struct oklab lab_to = oklab_from_color_unchecked(to);
+  float dl = (lab_to.l - lab_from.l) / max_steps;
+  float da = (lab_to.a - lab_from.a) / max_steps;
+  float db = (lab_to.b - lab_from.b) / max_steps;
+
+  for (int step = 1; step < max_steps; step++) {
+    struct oklab lab = { lab_from.l + dl * step,
+                         lab_from.a + da * step,
+                         lab_from.b + db * step };
+    out[step] = oklab_to_color_unchecked(lab, alpha);
+  }
+  out[max_steps] = (alpha << 24) | (to & 0x00ffffff);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+
+// Perceptual interpolation of packed 0xAARRGGBB colors in the OKLab space.
+// The sRGB transfer functions and the cube root are backed by lookup tables,
+// only the matrix multiplications are computed.
+
+struct oklab {
+  float l;
+  float a;
+  float b;
+};
+
+struct oklab oklab_from_color(uint32_t color);
+
+// Converts back to sRGB with the given alpha channel, out of gamut colors are
+// clipped per channel
+uint32_t oklab_to_color(struct oklab lab, uint32_t alpha);
+
+// Fills out[0...max_steps] with the transition from color_from to color_to.
+// The endpoints are converted once and reproduced exactly, the alpha follows
+// interpolate_color_value (source alpha, 0xFF if it is transparent).
+void oklab_color_steps(uint32_t from, uint32_t to, uint32_t* out, int max_steps);
@@ -1,6 +1,9 @@
 #include "parse.h"
-#include "border.h"
 #include "hashtable.h"
+#include "angle.h"
+#include "gradient.h"
+#include <stdio.h>
+#include <string.h>
 #include <stdlib.h> // For malloc, realloc, free, strtoul
 #include <ctype.h>  // For isxdigit, tolower
 
@@ -31,6 +34,7 @@ static bool parse_list(struct table* list, char* token) {
 }
 
 static bool parse_color(struct color_style* style, char* token) {
+  float angle;
   if (sscanf(token, "=0x%x", &style->color) == 1) {
     style->stype = COLOR_STYLE_SOLID;
     return true;
@@ -55,6 +59,16 @@ static bool parse_color(struct color_style* style, char* token) {
     style->gradient.direction = TR_TO_BL;
     return true;
   }
+  else if (sscanf(token,
+             "=gradient(angle=%f,start=0x%x,end=0x%x)",
+             &angle,
+             &style->gradient.color1,
+             &style->gradient.color2) == 3) {
+    style->stype = COLOR_STYLE_GRADIENT;
+    style->gradient.direction = ANGLE;
+    style->gradient.angle = angle_from_degrees(angle);
+    return true;
+  }
   else printf("[?] Borders: Invalid color argument color%s\n", token);
 
   return false;
@@ -111,59 +125,63 @@ static bool hex_string_to_uint32(const char* hex_str, uint32_t* out_color) {
     }
 }
 
+// The palette is immutable and may be shared with copies of the settings, so
+// it is never modified in place: a new one replaces the reference this
+// settings struct owns.
 static bool parse_animated_gradient_colors(struct settings* settings, char* token) {
-    if (settings->parsed_gradient_colors) {
-        free(settings->parsed_gradient_colors);
-        settings->parsed_gradient_colors = NULL;
-        settings->num_parsed_gradient_colors = 0;
-    }
-
     uint32_t token_len = strlen(token) + 1;
     char copy[token_len];
     memcpy(copy, token, token_len);
 
+    // There are never more colors than characters
+    uint32_t colors[token_len];
     char* color_str;
     char* cursor = copy;
     int count = 0;
-    int capacity = 10; // Initial capacity
-
-    settings->parsed_gradient_colors = malloc(capacity * sizeof(uint32_t));
-    if (!settings->parsed_gradient_colors) {
-        perror("[!] Borders: Failed to allocate memory for gradient colors");
-        return false;
-    }
 
     while ((color_str = strsep(&cursor, ","))) {
         if (strlen(color_str) > 0) {
             uint32_t color_val;
             if (hex_string_to_uint32(color_str, &color_val)) {
-                if (count >= capacity) {
-                    capacity *= 2;
-                    uint32_t* new_alloc = realloc(settings->parsed_gradient_colors, capacity * sizeof(uint32_t));
-                    if (!new_alloc) {
-                        perror("[!] Borders: Failed to reallocate memory for gradient colors");
-                        free(settings->parsed_gradient_colors); // Free old block
-                        settings->parsed_gradient_colors = NULL;
-                        settings->num_parsed_gradient_colors = 0;
-                        return false;
-                    }
-                    settings->parsed_gradient_colors = new_alloc;
-                }
-                settings->parsed_gradient_colors[count++] = color_val;
+                colors[count++] = color_val;
             } else {
                 // hex_string_to_uint32 already printed an error
                 // Continue parsing other colors if possible, or decide to fail all
             }
         }
     }
-    settings->num_parsed_gradient_colors = count;
-    if (count == 0 && settings->parsed_gradient_colors) { // No valid colors parsed
-        free(settings->parsed_gradient_colors);
-        settings->parsed_gradient_colors = NULL;
-    }
+
+    // No valid colors parsed leaves no palette
+    gradient_palette_release(settings->animated_gradient_palette);
+    settings->animated_gradient_palette = gradient_palette_create(colors, count);
     return count > 0;
 }
 
+// The x coordinates of the control points have to lie in [0, 1] for the
+// curve to be a function of the progress, the y coordinates may overshoot
+static bool parse_easing(struct easing* easing, char* value) {
+    struct easing parsed = { 0 };
+    if (strcmp(value, "linear") == 0) {
+        parsed.type = EASING_LINEAR;
+    } else if (strcmp(value, "ease-in-out") == 0) {
+        parsed.type = EASING_EASE_IN_OUT;
+    } else if (sscanf(value,
+                      "cubic-bezier(%f,%f,%f,%f)",
+                      &parsed.x1,
+                      &parsed.y1,
+                      &parsed.x2,
+                      &parsed.y2                  ) == 4
+               && parsed.x1 >= 0.f && parsed.x1 <= 1.f
+               && parsed.x2 >= 0.f && parsed.x2 <= 1.f) {
+        parsed.type = EASING_CUBIC_BEZIER;
+    } else {
+        printf("[?] Borders: Invalid value for animated_gradient_easing: '%s' (expected 'linear', 'ease-in-out' or 'cubic-bezier(x1,y1,x2,y2)' with x1 and x2 in [0, 1])\n", value);
+        return false;
+    }
+    *easing = parsed;
+    return true;
+}
+
 // --- End Helper functions ---
 
 uint32_t parse_settings(struct settings* settings, int count, char** arguments) {
@@ -172,11 +190,16 @@ uint32_t parse_settings(struct settings* settings, int count, char** arguments)
   static char background_color[] = "background_color";
   static char blacklist[] = "blacklist=";
   static char whitelist[] = "whitelist=";
+  static char stats[] = "--stats=";
   // --- Added for Gradient Animation ---
   static char animated_gradient_opt[] = "animated_gradient";
   static char animated_gradient_colors_opt[] = "animated_gradient_colors=";
   static char animated_gradient_steps_opt[] = "animated_gradient_steps=";
   static char animated_gradient_duration_opt[] = "animated_gradient_duration=";
+  static char animated_gradient_space_opt[] = "animated_gradient_space=";
+  static char animated_gradient_order_opt[] = "animated_gradient_order=";
+  static char animated_gradient_inactive_opt[] = "animated_gradient_inactive=";
+  static char animated_gradient_easing_opt[] = "animated_gradient_easing=";
   // --- End Added for Gradient Animation ---
 
 
@@ -214,6 +237,14 @@ uint32_t parse_settings(struct settings* settings, int count, char** arguments)
                                                + strlen(whitelist));
       update_mask |= BORDER_UPDATE_MASK_RECREATE_ALL;
     }
+    else if (str_starts_with(arguments[i], stats)) {
+      char* value = arguments[i] + strlen(stats);
+      if (strcmp(value, "animation") == 0) {
+        update_mask |= BORDER_UPDATE_MASK_STATS;
+      } else {
+        printf("[?] Borders: Invalid value for --stats: '%s' (expected 'animation')\n", value);
+      }
+    }
     // --- Added for Gradient Animation ---
     else if (str_starts_with(arguments[i], animated_gradient_colors_opt)) {
         if (parse_animated_gradient_colors(settings, arguments[i] + strlen(animated_gradient_colors_opt))) {
@@ -228,6 +259,77 @@ uint32_t parse_settings(struct settings* settings, int count, char** arguments)
         if (settings->animated_gradient_duration_sec <= 0.0f) settings->animated_gradient_duration_sec = 1.0f; // Ensure positive
         update_mask |= BORDER_UPDATE_MASK_ACTIVE;
     }
+    else if (sscanf(arguments[i], "animated_gradient_speed=%f", &settings->animated_gradient_speed) == 1) {
+        if (settings->animated_gradient_speed <= 0.0f) settings->animated_gradient_speed = 1.0f; // Ensure positive
+        update_mask |= BORDER_UPDATE_MASK_ACTIVE;
+    }
+    else if (sscanf(arguments[i], "animated_gradient_phase=%f", &settings->animated_gradient_phase) == 1) {
+        if (settings->animated_gradient_phase < 0.0f) settings->animated_gradient_phase = 0.0f;
+        update_mask |= BORDER_UPDATE_MASK_ACTIVE;
+    }
+    else if (sscanf(arguments[i], "animated_gradient_angle=%f", &settings->animated_gradient_angle) == 1) {
+        settings->animated_gradient_angled = true;
+        update_mask |= BORDER_UPDATE_MASK_ACTIVE;
+    }
+    else if (sscanf(arguments[i], "animated_gradient_rotation=%f", &settings->animated_gradient_rotation) == 1) {
+        if (settings->animated_gradient_rotation != 0.0f) settings->animated_gradient_angled = true;
+        update_mask |= BORDER_UPDATE_MASK_ACTIVE;
+    }
+    else if (sscanf(arguments[i], "animated_gradient_seed=%u", &settings->animated_gradient_seed) == 1) {
+        update_mask |= BORDER_UPDATE_MASK_ACTIVE;
+    }
+    else if (sscanf(arguments[i], "animated_gradient_inactive_rate=%f", &settings->animated_gradient_inactive_rate) == 1) {
+        if (settings->animated_gradient_inactive_rate <= 0.0f) settings->animated_gradient_inactive_rate = 10.0f; // Ensure positive
+        update_mask |= BORDER_UPDATE_MASK_INACTIVE;
+    }
+    else if (str_starts_with(arguments[i], animated_gradient_inactive_opt)) {
+        char* value = arguments[i] + strlen(animated_gradient_inactive_opt);
+        if (strcmp(value, "on") == 0) {
+            settings->animated_gradient_inactive = true;
+            update_mask |= BORDER_UPDATE_MASK_INACTIVE;
+        } else if (strcmp(value, "off") == 0) {
+            settings->animated_gradient_inactive = false;
+            update_mask |= BORDER_UPDATE_MASK_INACTIVE;
+        } else {
+            printf("[?] Borders: Invalid value for animated_gradient_inactive: '%s' (expected 'on' or 'off')\n", value);
+        }
+    }
+    else if (str_starts_with(arguments[i], animated_gradient_order_opt)) {
+        char* value = arguments[i] + strlen(animated_gradient_order_opt);
+        if (strcmp(value, "random") == 0) {
+            settings->animated_gradient_order = GRADIENT_ORDER_RANDOM;
+            update_mask |= BORDER_UPDATE_MASK_ACTIVE;
+        } else if (strcmp(value, "sequential") == 0) {
+            settings->animated_gradient_order = GRADIENT_ORDER_SEQUENTIAL;
+            update_mask |= BORDER_UPDATE_MASK_ACTIVE;
+        } else if (strcmp(value, "pingpong") == 0) {
+            settings->animated_gradient_order = GRADIENT_ORDER_PINGPONG;
+            update_mask |= BORDER_UPDATE_MASK_ACTIVE;
+        } else if (strcmp(value, "shuffle") == 0) {
+            settings->animated_gradient_order = GRADIENT_ORDER_SHUFFLE;
+            update_mask |= BORDER_UPDATE_MASK_ACTIVE;
+        } else {
+            printf("[?] Borders: Invalid value for animated_gradient_order: '%s' (expected 'random', 'sequential', 'pingpong' or 'shuffle')\n", value);
+        }
+    }
+    else if (str_starts_with(arguments[i], animated_gradient_easing_opt)) {
+        if (parse_easing(&settings->animated_gradient_easing,
+                         arguments[i] + strlen(animated_gradient_easing_opt))) {
+            update_mask |= BORDER_UPDATE_MASK_ACTIVE;
+        }
+    }
+    else if (str_starts_with(arguments[i], animated_gradient_space_opt)) {
+        char* value = arguments[i] + strlen(animated_gradient_space_opt);
+        if (strcmp(value, "srgb") == 0) {
+            settings->animated_gradient_space = GRADIENT_SPACE_SRGB;
+            update_mask |= BORDER_UPDATE_MASK_ACTIVE;
+        } else if (strcmp(value, "oklab") == 0) {
+            settings->animated_gradient_space = GRADIENT_SPACE_OKLAB;
+            update_mask |= BORDER_UPDATE_MASK_ACTIVE;
+        } else {
+            printf("[?] Borders: Invalid value for animated_gradient_space: '%s' (expected 'srgb' or 'oklab')\n", value);
+        }
+    }
     else if (str_starts_with(arguments[i], animated_gradient_opt)) {
         char* value = arguments[i] + strlen(animated_gradient_opt);
         if (*value == '=') value++; // Skip '=' if present, e.g., animated_gradient=on
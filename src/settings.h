@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "hashtable.h"
+#include "misc/color.h"
+#include "easing.h"
+
+struct gradient_palette;
+
+#define BORDER_ORDER_ABOVE 1
+#define BORDER_ORDER_BELOW -1
+#define BORDER_STYLE_ROUND  'r'
+#define BORDER_STYLE_ROUND_UNIFORM 'u'
+#define BORDER_STYLE_SQUARE 's'
+
+struct color_style {
+  enum { COLOR_STYLE_GRADIENT, COLOR_STYLE_SOLID, COLOR_STYLE_GLOW } stype;
+  union {
+    uint32_t color;
+    struct gradient gradient;
+  };
+};
+
+struct settings {
+  bool enabled;
+  uint32_t apply_to;
+
+  struct color_style active_window;
+  struct color_style inactive_window;
+  struct color_style corner_mask;
+  struct color_style background;
+
+  float border_width;
+  float blur_radius;
+  char border_style;
+  bool hidpi;
+  bool show_background;
+  int border_order;
+  bool ax_focus;
+
+  bool blacklist_enabled;
+  struct table blacklist;
+
+  bool whitelist_enabled;
+  struct table whitelist;
+
+  // --- Added for Gradient Animation ---
+  bool animated_gradient_enabled;
+  struct gradient_palette* animated_gradient_palette; // Owned reference
+  int animated_gradient_steps;
+  float animated_gradient_duration_sec;
+  enum { GRADIENT_SPACE_SRGB, GRADIENT_SPACE_OKLAB } animated_gradient_space;
+  float animated_gradient_speed;    // Multiplier of the transition rate
+  float animated_gradient_phase;    // Offset in transitions, e.g. 0.5
+  enum { GRADIENT_ORDER_RANDOM,
+         GRADIENT_ORDER_SEQUENTIAL,
+         GRADIENT_ORDER_PINGPONG,
+         GRADIENT_ORDER_SHUFFLE    } animated_gradient_order;
+  uint32_t animated_gradient_seed;  // 0 seeds from the clock
+  bool animated_gradient_inactive;  // Also animate the inactive borders
+  float animated_gradient_inactive_rate; // Redraws per second of each
+  bool animated_gradient_angled;    // Direction by angle instead of corners
+  float animated_gradient_angle;    // Degrees clockwise from pointing up
+  float animated_gradient_rotation; // Degrees per second, < 0 counterclockwise
+  struct easing animated_gradient_easing;
+  // struct table animated_gradient_color_list; // Optional: if raw strings are needed for other purposes
+  // --- End Added for Gradient Animation ---
+};
@@ -0,0 +1,95 @@
+#include "slotmap.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SLOTMAP_FREE_END UINT32_MAX
+
+void slotmap_init(struct slotmap* map, int capacity) {
+  memset(map, 0, sizeof(struct slotmap));
+  map->capacity = capacity > 0 ? capacity : 1;
+  map->values = malloc(sizeof(void*) * map->capacity);
+  map->value_slots = malloc(sizeof(uint32_t) * map->capacity);
+  map->slots = malloc(sizeof(struct slot) * map->capacity);
+  map->free_slot = SLOTMAP_FREE_END;
+}
+
+void slotmap_free(struct slotmap* map) {
+  if (map->values) free(map->values);
+  if (map->value_slots) free(map->value_slots);
+  if (map->slots) free(map->slots);
+  memset(map, 0, sizeof(struct slotmap));
+}
+
+void slotmap_clear(struct slotmap* map) {
+  // Bump every live slot generation so outstanding handles go stale
+  for (int i = 0; i < map->count; ++i) {
+    struct slot* slot = map->slots + map->value_slots[i];
+    slot->generation++;
+    slot->index = map->free_slot;
+    map->free_slot = map->value_slots[i];
+  }
+  map->count = 0;
+}
+
+static void slotmap_grow(struct slotmap* map) {
+  map->capacity *= 2;
+  map->values = realloc(map->values, sizeof(void*) * map->capacity);
+  map->value_slots = realloc(map->value_slots,
+                             sizeof(uint32_t) * map->capacity);
+  map->slots = realloc(map->slots, sizeof(struct slot) * map->capacity);
+}
+
+uint64_t slotmap_insert(struct slotmap* map, void* value) {
+  if (map->count >= map->capacity || map->slot_count >= map->capacity) {
+    slotmap_grow(map);
+  }
+
+  uint32_t slot_index;
+  if (map->free_slot != SLOTMAP_FREE_END) {
+    slot_index = map->free_slot;
+    map->free_slot = map->slots[slot_index].index;
+  } else {
+    slot_index = map->slot_count++;
+    map->slots[slot_index].generation = 1;
+  }
+
+  struct slot* slot = map->slots + slot_index;
+  slot->index = map->count;
+  map->values[map->count] = value;
+  map->value_slots[map->count] = slot_index;
+  map->count++;
+
+  return ((uint64_t)slot->generation << 32) | slot_index;
+}
+
+static struct slot* slotmap_get_slot(struct slotmap* map, uint64_t handle) {
+  uint32_t slot_index = SLOTMAP_HANDLE_INDEX(handle);
+  if (slot_index >= map->slot_count) return NULL;
+
+  struct slot* slot = map->slots + slot_index;
+  if (slot->generation != SLOTMAP_HANDLE_GENERATION(handle)) return NULL;
+  return slot;
+}
+
+void slotmap_remove(struct slotmap* map, uint64_t handle) {
+  struct slot* slot = slotmap_get_slot(map, handle);
+  if (!slot) return;
+
+  // Swap the last value into the hole to keep the value array dense
+  uint32_t index = slot->index;
+  uint32_t last = --map->count;
+  if (index != last) {
+    map->values[index] = map->values[last];
+    map->value_slots[index] = map->value_slots[last];
+    map->slots[map->value_slots[index]].index = index;
+  }
+
+  slot->generation++;
+  slot->index = map->free_slot;
+  map->free_slot = SLOTMAP_HANDLE_INDEX(handle);
+}
+
+void* slotmap_get(struct slotmap* map, uint64_t handle) {
+  struct slot* slot = slotmap_get_slot(map, handle);
+  return slot ? map->values[slot->index] : NULL;
+}
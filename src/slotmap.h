@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Dense storage with stable handles: values live in a contiguous array which
+// bulk passes can walk directly, while handles stay valid (and detect stale
+// use) across removals. A handle packs the slot generation in the upper and
+// the slot index in the lower 32 bits, 0 is never a valid handle.
+#define SLOTMAP_HANDLE_INDEX(handle) ((uint32_t)(handle))
+#define SLOTMAP_HANDLE_GENERATION(handle) ((uint32_t)((handle) >> 32))
+
+struct slot
+{
+  uint32_t generation;
+  uint32_t index;
+};
+struct slotmap
+{
+  int count;
+  int capacity;
+  void** values;
+  uint32_t* value_slots;
+
+  int slot_count;
+  uint32_t free_slot;
+  struct slot* slots;
+};
+
+void slotmap_init(struct slotmap* map, int capacity);
+void slotmap_free(struct slotmap* map);
+void slotmap_clear(struct slotmap* map);
+
+uint64_t slotmap_insert(struct slotmap* map, void* value);
+void slotmap_remove(struct slotmap* map, uint64_t handle);
+void* slotmap_get(struct slotmap* map, uint64_t handle);
@@ -0,0 +1,87 @@
+#include "space_index.h"
+#include <stdlib.h>
+
+static TABLE_HASH_FUNC(hash_space) {
+  uint64_t sid = *(uint64_t*)key;
+  return (unsigned long)(sid ^ (sid >> 32));
+}
+
+static TABLE_COMPARE_FUNC(cmp_space) {
+  return *(uint64_t*)key_a == *(uint64_t*)key_b;
+}
+
+void space_index_init(struct space_index* index, int capacity, space_visible_func* visible) {
+  table_init_pooled(&index->lists, capacity, hash_space, cmp_space);
+  index->visible = visible;
+}
+
+static void space_index_free_lists(struct space_index* index) {
+  int cursor = 0;
+  struct bucket* bucket = NULL;
+  struct space_list* list;
+  while ((list = space_index_iterate(index, &cursor, &bucket))) free(list);
+}
+
+void space_index_free(struct space_index* index) {
+  space_index_free_lists(index);
+  table_free(&index->lists);
+}
+
+void space_index_clear(struct space_index* index) {
+  space_index_free_lists(index);
+  table_clear(&index->lists);
+}
+
+struct space_list* space_index_find(struct space_index* index, uint64_t sid) {
+  return table_find(&index->lists, &sid);
+}
+
+bool space_index_file(struct space_index* index, struct space_link* link, uint64_t sid) {
+  if (link->list && link->list->sid == sid) return false;
+
+  space_index_unlink(index, link);
+  struct space_list* list = space_index_find(index, sid);
+  if (!list) {
+    list = malloc(sizeof(struct space_list));
+    list->sid = sid;
+    list->visible = sid == 0 || (index->visible && index->visible(sid));
+    list->head = NULL;
+    table_add(&index->lists, &sid, list);
+  }
+
+  link->list = list;
+  link->prev = NULL;
+  link->next = list->head;
+  if (list->head) list->head->prev = link;
+  list->head = link;
+  return true;
+}
+
+void space_index_unlink(struct space_index* index, struct space_link* link) {
+  struct space_list* list = link->list;
+  if (!list) return;
+
+  if (link->prev) link->prev->next = link->next;
+  else list->head = link->next;
+  if (link->next) link->next->prev = link->prev;
+
+  link->list = NULL;
+  link->next = NULL;
+  link->prev = NULL;
+
+  if (!list->head) {
+    table_remove(&index->lists, &list->sid);
+    free(list);
+  }
+}
+
+struct space_list* space_index_iterate(struct space_index* index, int* cursor, struct bucket** bucket) {
+  do {
+    if (*bucket) *bucket = (*bucket)->next;
+    while (!*bucket) {
+      if (*cursor >= index->lists.capacity) return NULL;
+      *bucket = index->lists.buckets[(*cursor)++];
+    }
+  } while (!(*bucket)->value);
+  return (*bucket)->value;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "hashtable.h"
+
+// Multimap of space ids to the windows living on them. Each window embeds a
+// space_link, which threads it into the list of its space, so filing and
+// unlinking never allocate beyond the list of a new space. Sticky windows
+// are filed under the space id 0. Not thread safe, the index is owned by the
+// main thread.
+
+struct space_list;
+
+struct space_link {
+  void* owner;
+  struct space_list* list;    // NULL while not filed
+  struct space_link* next;
+  struct space_link* prev;
+};
+
+struct space_list {
+  uint64_t sid;
+  bool visible;
+  struct space_link* head;
+};
+
+#define SPACE_VISIBLE_FUNC(name) bool name(uint64_t sid)
+typedef SPACE_VISIBLE_FUNC(space_visible_func);
+
+struct space_index {
+  struct table lists;         // Space id to struct space_list
+  space_visible_func* visible;
+};
+
+// visible decides whether the list of a space seen for the first time starts
+// out visible, the space id 0 always does
+void space_index_init(struct space_index* index, int capacity, space_visible_func* visible);
+void space_index_free(struct space_index* index);
+
+// Drops every list, the links are left dangling and must be reset by the
+// caller (or be freed along with their owners)
+void space_index_clear(struct space_index* index);
+
+struct space_list* space_index_find(struct space_index* index, uint64_t sid);
+
+// Files the link under sid, moving it out of the list it was in. Returns
+// whether it moved.
+bool space_index_file(struct space_index* index, struct space_link* link, uint64_t sid);
+
+// Removes the link from its list, the list is released once it is empty
+void space_index_unlink(struct space_index* index, struct space_link* link);
+
+// Walks the lists: start with *cursor = 0, returns NULL once done
+struct space_list* space_index_iterate(struct space_index* index, int* cursor, struct bucket** bucket);
@@ -0,0 +1,24 @@
+#include "timeline.h"
+
+void timeline_init(struct timeline* timeline, uint64_t period, uint64_t phase) {
+  timeline->started = false;
+  timeline->start = 0;
+  timeline->last = 0;
+  timeline->period = period > 0 ? period : 1;
+  timeline->phase = phase % timeline->period;
+}
+
+void timeline_position(struct timeline* timeline, uint64_t now, uint64_t* transition, double* progress) {
+  if (!timeline->started) {
+    timeline->started = true;
+    timeline->start = now;
+    timeline->last = now;
+  }
+  if (now < timeline->last) now = timeline->last;
+  timeline->last = now;
+
+  // Integer division keeps the position exact however long the timeline runs
+  uint64_t elapsed = now - timeline->start + timeline->phase;
+  *transition = elapsed / timeline->period;
+  *progress = (double)(elapsed % timeline->period) / timeline->period;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Position of a looping sequence of equally long transitions as a closed form
+// function of a monotonic clock: frames compute where they are instead of
+// accumulating their nominal duration, so jitter, dropped frames and sleep do
+// not cause any drift or catch up work.
+struct timeline {
+  bool started;
+  uint64_t start;
+  uint64_t last;
+  uint64_t period;    // Clock ticks per transition
+  uint64_t phase;     // Offset of the first frame in clock ticks
+};
+
+void timeline_init(struct timeline* timeline, uint64_t period, uint64_t phase);
+
+// Maps the clock value now to the index of the current transition and the
+// progress within it in [0, 1). The first call starts the timeline, values
+// going backwards are clamped to the latest one seen.
+void timeline_position(struct timeline* timeline, uint64_t now, uint64_t* transition, double* progress);
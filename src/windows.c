@@ -8,6 +8,47 @@
 extern pid_t g_pid;
 extern struct settings g_settings;
 
+static SPACE_VISIBLE_FUNC(windows_space_visible) {
+  return is_space_visible(SLSMainConnectionID(), sid);
+}
+
+void windows_init(struct windows* windows) {
+  wid_table_init(&windows->table, 1024);
+  slotmap_init(&windows->borders, 64);
+  space_index_init(&windows->spaces, 64, windows_space_visible);
+  windows->focused = NULL;
+  windows->consistency_pending = false;
+}
+
+// Files the border under its current space (or the sticky list). Runs on the
+// main thread whenever the sid or the sticky tag of a border may have changed,
+// an async update may be writing them at the same time.
+static void windows_space_index(struct windows* windows, struct border* border) {
+  pthread_mutex_lock(&border->mutex);
+  uint64_t sid = border->sticky ? 0 : border->sid;
+  pthread_mutex_unlock(&border->mutex);
+  space_index_file(&windows->spaces, &border->space, sid);
+}
+
+// Borders are released once no read section of the table can still hold
+// them, border_destroy then runs on the main thread as before
+static EPOCH_FREE_FUNC(windows_border_release) {
+  border_destroy(ptr);
+}
+
+static void windows_border_retire(struct windows* windows, struct border* border) {
+  border_hide(border);
+  wid_table_retire_value(&windows->table, border, windows_border_release);
+}
+
+struct border* windows_find(struct windows* windows, uint32_t wid) {
+  return wid_table_find(&windows->table, wid);
+}
+
+struct border* windows_get(struct windows* windows, uint64_t handle) {
+  return slotmap_get(&windows->borders, handle);
+}
+
 static bool window_in_list(struct table* list, char* app_name) {
   if (table_find(list, app_name)) return true;
   return false;
@@ -25,7 +66,7 @@ static bool app_allowed(struct settings* settings, char* app_name) {
   return true;
 }
 
-bool windows_window_create(struct table* windows, uint32_t wid, uint64_t sid) {
+bool windows_window_create(struct windows* windows, uint32_t wid, uint64_t sid) {
   bool window_created = false;
   int cid = SLSMainConnectionID();
   int wid_cid = 0;
@@ -51,10 +92,11 @@ bool windows_window_create(struct table* windows, uint32_t wid, uint64_t sid) {
     if (iterator && SLSWindowIteratorGetCount(iterator) > 0) {
       if (SLSWindowIteratorAdvance(iterator)) {
         if (window_suitable(iterator)) {
-          struct border* border = table_find(windows, &wid);
+          struct border* border = windows_find(windows, wid);
           if (!border) {
             border = border_create();
-            table_add(windows, &wid, border);
+            border->handle = slotmap_insert(&windows->borders, border);
+            wid_table_add(&windows->table, wid, border);
             window_created = true;
           }
 
@@ -78,6 +120,7 @@ bool windows_window_create(struct table* windows, uint32_t wid, uint64_t sid) {
           border->target_wid = wid;
           border->sid = sid;
           border_update(border, false);
+          windows_space_index(windows, border);
           windows_update_notifications(windows);
         }
       }
@@ -90,153 +133,132 @@ bool windows_window_create(struct table* windows, uint32_t wid, uint64_t sid) {
   return window_created;
 }
 
-static void windows_remove_all(struct table* windows) {
-  for (int i = 0; i < windows->capacity; ++i) {
-    struct bucket* bucket = windows->buckets[i];
-    while (bucket) {
-      if (bucket->value) {
-        struct border* border = bucket->value;
-        border_destroy(border);
-      }
-      bucket = bucket->next;
-    }
+static void windows_remove_all(struct windows* windows) {
+  wid_table_clear(&windows->table);
+  for (int i = 0; i < windows->borders.count; ++i) {
+    windows_border_retire(windows, windows->borders.values[i]);
   }
-  table_clear(windows);
+  slotmap_clear(&windows->borders);
+  space_index_clear(&windows->spaces);
+  windows->focused = NULL;
   windows_update_notifications(windows);
 }
 
-void windows_recreate_all_borders(struct table* windows) {
+void windows_recreate_all_borders(struct windows* windows) {
   windows_remove_all(windows);
   windows_add_existing_windows(windows);
 }
 
-void windows_update_all(struct table* windows) {
-  for (int i = 0; i < windows->capacity; ++i) {
-    struct bucket* bucket = windows->buckets[i];
-    while (bucket) {
-      if (bucket->value) {
-        struct border* border = bucket->value;
-        if (border) {
-          border->needs_redraw = true;
-          border_update(border, true);
-        }
-      }
-      bucket = bucket->next;
-    }
+void windows_update_all(struct windows* windows) {
+  for (int i = 0; i < windows->borders.count; ++i) {
+    struct border* border = windows->borders.values[i];
+    border->needs_redraw = true;
+    border_update(border, true);
   }
 }
 
-void windows_update_active(struct table* windows) {
-  for (int i = 0; i < windows->capacity; ++i) {
-    struct bucket* bucket = windows->buckets[i];
-    while (bucket) {
-      if (bucket->value) {
-        struct border* border = bucket->value;
-        if (border && border->focused) {
-          border->needs_redraw = true;
-          border_update(border, true);
-        }
-      }
-      bucket = bucket->next;
-    }
+void windows_update_active(struct windows* windows) {
+  struct border* border = windows->focused;
+  if (border) {
+    border->needs_redraw = true;
+    border_update(border, true);
   }
 }
 
-void windows_update_inactive(struct table* windows) {
-  for (int i = 0; i < windows->capacity; ++i) {
-    struct bucket* bucket = windows->buckets[i];
-    while (bucket) {
-      if (bucket->value) {
-        struct border* border = bucket->value;
-        if (border && !border->focused) {
-          border->needs_redraw = true;
-          border_update(border, true);
-        }
-      }
-      bucket = bucket->next;
+void windows_update_inactive(struct windows* windows) {
+  for (int i = 0; i < windows->borders.count; ++i) {
+    struct border* border = windows->borders.values[i];
+    if (!border->focused) {
+      border->needs_redraw = true;
+      border_update(border, true);
     }
   }
 }
 
-void windows_window_update(struct table* windows, uint32_t wid) {
-  struct border* border = table_find(windows, &wid);
+void windows_window_update(struct windows* windows, uint32_t wid) {
+  struct border* border = windows_find(windows, wid);
   if (border) border_update(border, true);
 }
 
-static bool windows_window_focus(struct table* windows, uint32_t wid) {
-  bool found_window = false;
-  for (int i = 0; i < windows->capacity; ++i) {
-    struct bucket* bucket = windows->buckets[i];
-    while (bucket) {
-      if (bucket->value) {
-        struct border* border = bucket->value;
-        if (border->focused && border->target_wid != wid) {
-          border->focused = false;
-          border->needs_redraw = true;
-          border_update(border, true);
-        }
+void windows_window_reindex(struct windows* windows, uint64_t handle) {
+  struct border* border = windows_get(windows, handle);
+  if (!border) return;
 
-        if (!border->focused && border->target_wid == wid) {
-          border->focused = true;
-          border->needs_redraw = true;
-          border_update(border, true);
-        }
+  windows_space_index(windows, border);
 
-        if (border->target_wid == wid) found_window = true;
-      }
-      bucket = bucket->next;
-    }
-  }
+  // The async update skipped the border if it moved to a hidden space
+  if (!border->space.list->visible) border_hide(border);
+}
+
+static void windows_set_focused(struct border* border, bool focused) {
+  pthread_mutex_lock(&border->mutex);
+  border->focused = focused;
+  border->needs_redraw = true;
+  if (border->proxy) border->proxy->focused = focused;
+  pthread_mutex_unlock(&border->mutex);
+  border_update(border, true);
+}
+
+static bool windows_window_focus(struct windows* windows, uint32_t wid) {
+  struct border* border = windows_find(windows, wid);
+  struct border* focused = windows->focused;
 
-  return found_window;
+  if (focused && focused != border) windows_set_focused(focused, false);
+  if (border && !border->focused) windows_set_focused(border, true);
+
+  windows->focused = border;
+  return border != NULL;
 }
 
-void windows_window_move(struct table* windows, uint32_t wid) {
-  struct border* border = table_find(windows, &wid);
+void windows_window_move(struct windows* windows, uint32_t wid) {
+  struct border* border = windows_find(windows, wid);
   if (border) border_move(border);
 }
 
-void windows_window_hide(struct table* windows, uint32_t wid) {
-  struct border* border = table_find(windows, &wid);
-  if (border) border_hide(border);
+void windows_window_hide(struct windows* windows, uint32_t wid) {
+  struct border* border = windows_find(windows, wid);
+  if (border) {
+    border->hidden = true;
+    border_hide(border);
+  }
 }
 
-void windows_window_unhide(struct table* windows, uint32_t wid) {
-  struct border* border = table_find(windows, &wid);
-  if (border) border_unhide(border);
+void windows_window_unhide(struct windows* windows, uint32_t wid) {
+  struct border* border = windows_find(windows, wid);
+  if (border) {
+    border->hidden = false;
+    border_unhide(border);
+  }
 }
 
-bool windows_window_destroy(struct table* windows, uint32_t wid, uint32_t sid) {
-  struct border* border = table_find(windows, &wid);
+bool windows_window_destroy(struct windows* windows, uint32_t wid, uint32_t sid) {
+  struct border* border = windows_find(windows, wid);
   if (border && (border->sid == sid || border->sticky || sid == 0)) {
-    table_remove(windows, &wid);
-    border_destroy(border);
+    wid_table_remove(&windows->table, wid);
+    slotmap_remove(&windows->borders, border->handle);
+    space_index_unlink(&windows->spaces, &border->space);
+    if (windows->focused == border) windows->focused = NULL;
+    windows_border_retire(windows, border);
     windows_update_notifications(windows);
     return true;
   }
   return false;
 }
 
-void windows_update_notifications(struct table* windows) {
+void windows_update_notifications(struct windows* windows) {
   int window_count = 0;
   uint32_t window_list[1024] = {};
 
-  for (int i = 0; i < windows->capacity; ++i) {
-    struct bucket *bucket = windows->buckets[i];
-    while (bucket) {
-      if (bucket->value) {
-        uint32_t wid = *(uint32_t *) bucket->key;
-        window_list[window_count++] = wid;
-      }
-      bucket = bucket->next;
-    }
+  for (int i = 0; i < windows->borders.count && i < 1024; ++i) {
+    struct border* border = windows->borders.values[i];
+    window_list[window_count++] = border->target_wid;
   }
 
   int cid = SLSMainConnectionID();
   SLSRequestNotificationsForWindows(cid, window_list, window_count);
 }
 
-void windows_determine_and_focus_active_window(struct table* windows) {
+void windows_determine_and_focus_active_window(struct windows* windows) {
   int cid = SLSMainConnectionID();
   uint32_t front_wid = g_settings.ax_focus
                        ? ax_get_front_window(cid)
@@ -253,12 +275,29 @@ void windows_determine_and_focus_active_window(struct table* windows) {
   }
 }
 
-void windows_draw_borders_on_current_spaces(struct table* windows) {
-  debug("Space Change: Consistency check\n");
-  int cid = SLSMainConnectionID();
+static bool space_in_list(uint64_t sid, uint64_t* space_list, uint32_t count) {
+  for (int i = 0; i < count; i++) {
+    if (space_list[i] == sid) return true;
+  }
+  return false;
+}
+
+static void windows_space_set_visible(struct space_list* space, bool visible) {
+  if (space->visible == visible) return;
+  space->visible = visible;
+
+  for (struct space_link* link = space->head; link; link = link->next) {
+    struct border* border = link->owner;
+    if (visible) border_update(border, true);
+    else border_hide(border);
+  }
+}
+
+// Fills space_list with the space shown on each display, returns the count
+static uint32_t windows_current_spaces(int cid, uint64_t* space_list, uint32_t capacity) {
   CFArrayRef displays = SLSCopyManagedDisplays(cid);
   uint32_t space_count = CFArrayGetCount(displays);
-  uint64_t space_list[space_count];
+  if (space_count > capacity) space_count = capacity;
 
   for (int i = 0; i < space_count; i++) {
     space_list[i] = SLSManagedDisplayGetCurrentSpace(cid,
@@ -266,6 +305,20 @@ void windows_draw_borders_on_current_spaces(struct table* windows) {
   }
 
   CFRelease(displays);
+  return space_count;
+}
+
+// Walks every window on the current spaces through the window server, to
+// create the borders of windows whose creation we missed and update those
+// which changed their space without an event (e.g. native fullscreen). Too
+// expensive for every space change, it runs once space changes settled.
+static void windows_check_consistency(struct windows* windows) {
+  debug("Space Change: Consistency check\n");
+  int cid = SLSMainConnectionID();
+  uint64_t space_list[WINDOWS_MAX_DISPLAYS];
+  uint32_t space_count = windows_current_spaces(cid,
+                                                space_list,
+                                                WINDOWS_MAX_DISPLAYS);
 
   CFArrayRef space_list_ref = cfarray_of_cfnumbers(space_list,
                                                    sizeof(uint64_t),
@@ -289,8 +342,14 @@ void windows_draw_borders_on_current_spaces(struct table* windows) {
         while(SLSWindowIteratorAdvance(iterator)) {
           if (window_suitable(iterator)) {
             uint32_t wid = SLSWindowIteratorGetWindowID(iterator);
-            struct border* border = table_find(windows, &wid);
-            if (border) border_update(border, true);
+            struct border* border = windows_find(windows, wid);
+            if (border) {
+              // Borders whose space is not indexed as visible have changed
+              // their space without us noticing
+              if (border->space.list && !border->space.list->visible) {
+                border_update(border, true);
+              }
+            }
             else {
               debug("Creating Missing Window: %d\n", wid);
               windows_window_create(windows, wid, window_space_id(cid, wid));
@@ -306,7 +365,45 @@ void windows_draw_borders_on_current_spaces(struct table* windows) {
   CFRelease(space_list_ref);
 }
 
-void windows_add_existing_windows(struct table* windows) {
+void windows_draw_borders_on_current_spaces(struct windows* windows) {
+  int cid = SLSMainConnectionID();
+  uint64_t space_list[WINDOWS_MAX_DISPLAYS];
+  uint32_t space_count = windows_current_spaces(cid,
+                                                space_list,
+                                                WINDOWS_MAX_DISPLAYS);
+
+  // Only borders on spaces which just came into view need an update, those on
+  // spaces which left the view are hidden.
+  int cursor = 0;
+  struct bucket* bucket = NULL;
+  struct space_list* space;
+  while ((space = space_index_iterate(&windows->spaces, &cursor, &bucket))) {
+    if (space->sid) {
+      windows_space_set_visible(space, space_in_list(space->sid,
+                                                     space_list,
+                                                     space_count));
+    }
+  }
+
+  struct space_list* sticky = space_index_find(&windows->spaces, 0);
+  struct space_link* link = sticky ? sticky->head : NULL;
+  while (link) {
+    border_update(link->owner, true);
+    link = link->next;
+  }
+
+  // A burst of space changes shares a single consistency check
+  if (windows->consistency_pending) return;
+  windows->consistency_pending = true;
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, WINDOWS_CONSISTENCY_DELAY),
+                 dispatch_get_main_queue(),
+                 ^{
+    windows->consistency_pending = false;
+    windows_check_consistency(windows);
+  });
+}
+
+void windows_add_existing_windows(struct windows* windows) {
   int cid = SLSMainConnectionID();
   uint64_t* space_list = NULL;
   int space_count = 0;
@@ -2,20 +2,51 @@
 #include <stdlib.h>
 #include "border.h"
 #include "hashtable.h"
+#include "slotmap.h"
+#include "space_index.h"
 
-void windows_update_inactive(struct table* windows);
-void windows_update_active(struct table* windows);
-void windows_update_all(struct table* windows);
-void windows_update_notifications(struct table* windows);
-
-void windows_window_update(struct table* windows, uint32_t wid);
-void windows_window_hide(struct table* windows, uint32_t wid);
-void windows_window_unhide(struct table* windows, uint32_t wid);
-void windows_window_move(struct table* windows, uint32_t wid);
-bool windows_window_create(struct table* windows, uint32_t wid, uint64_t sid);
-bool windows_window_destroy(struct table* windows, uint32_t wid, uint32_t sid);
-
-void windows_add_existing_windows(struct table* windows);
-void windows_draw_borders_on_current_spaces(struct table* windows);
-void windows_determine_and_focus_active_window(struct table* windows);
-void windows_recreate_all_borders(struct table* windows);
+#define WINDOWS_MAX_DISPLAYS 32
+
+// Delay of the window server scan after a space change, in nanoseconds
+#define WINDOWS_CONSISTENCY_DELAY (2ull * 1000000000ull)
+
+// Window registry: borders are looked up by target window id through the
+// table and stored densely in the slot map, so bulk passes only walk live
+// borders and handles stay valid across deletions. The focused border is
+// tracked directly so focus changes only touch the two borders involved,
+// and the space index maps space ids to the borders living on them.
+struct windows {
+  struct wid_table table;
+  struct slotmap borders;
+  struct border* focused;
+  struct space_index spaces;
+  bool consistency_pending;
+};
+
+void windows_init(struct windows* windows);
+// Off the main thread the border found may only be used within a read
+// section of the table (wid_table_read_begin/end), removed borders are
+// retired through it
+struct border* windows_find(struct windows* windows, uint32_t wid);
+struct border* windows_get(struct windows* windows, uint64_t handle);
+
+void windows_update_inactive(struct windows* windows);
+void windows_update_active(struct windows* windows);
+void windows_update_all(struct windows* windows);
+void windows_update_notifications(struct windows* windows);
+
+void windows_window_update(struct windows* windows, uint32_t wid);
+
+// Files the border under the space and sticky tag its async update found,
+// called on the main thread once the update saw either of them change
+void windows_window_reindex(struct windows* windows, uint64_t handle);
+void windows_window_hide(struct windows* windows, uint32_t wid);
+void windows_window_unhide(struct windows* windows, uint32_t wid);
+void windows_window_move(struct windows* windows, uint32_t wid);
+bool windows_window_create(struct windows* windows, uint32_t wid, uint64_t sid);
+bool windows_window_destroy(struct windows* windows, uint32_t wid, uint32_t sid);
+
+void windows_add_existing_windows(struct windows* windows);
+void windows_draw_borders_on_current_spaces(struct windows* windows);
+void windows_determine_and_focus_active_window(struct windows* windows);
+void windows_recreate_all_borders(struct windows* windows);